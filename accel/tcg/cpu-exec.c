@@ -311,10 +311,16 @@ static bool tb_lookup_cmp(const void *p, const void *d)
 
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc)
 {
+    TranslationBlock *tb;
     tb_page_addr_t phys_pc;
     struct tb_desc desc;
     uint32_t h;
 
+    tb = tb_image_lookup(pc);
+    if (tb) {
+        return tb;
+    }
+
     desc.env = (CPUArchState *)cpu->env_ptr;
     desc.pc = pc;
     phys_pc = get_page_addr_code(desc.env, pc);
@@ -1195,6 +1195,173 @@ static gboolean tb_host_size_iter(gpointer key, gpointer value, gpointer data)
     return false;
 }
 
+/*
+ * Guest code lives in the __TEXT of a few ARM images, so a TB can be found
+ * in a flat array per image indexed by (pc - text base) / 4, before trying
+ * tb_ctx.htable. Chunks of the array covering TB_IMAGE_CHUNK_SIZE bytes of
+ * text are allocated on first use. Entries are set and cleared with the
+ * hash table, under mmap_lock; each TB records the table it was entered
+ * in, so it is removed from there whatever the image map says by then.
+ * Tables are never freed: when their image is unloaded they are emptied
+ * and marked dead, which makes the threads caching them in tb_image_last
+ * go back to the image map.
+ */
+#define TB_IMAGE_CHUNK_SIZE     (64 * KiB)
+#define TB_IMAGE_CHUNK_ENTRIES  (TB_IMAGE_CHUNK_SIZE >> 2)
+
+struct TBImageTable {
+    target_ulong base;
+    target_ulong size;
+    struct TBImageTable *next;
+    bool dead;
+    size_t nb_chunks;
+    TranslationBlock **chunks[];
+};
+
+static TBImageTable *tb_image_tables;
+static __thread TBImageTable *tb_image_last;
+
+TBImageTable *tb_image_table_new(target_ulong base, target_ulong size)
+{
+    size_t nb_chunks = DIV_ROUND_UP(size, TB_IMAGE_CHUNK_SIZE);
+    TBImageTable *table = g_malloc0(sizeof(TBImageTable) +
+                                    nb_chunks * sizeof(TranslationBlock **));
+
+    table->base = base;
+    table->size = size;
+    table->nb_chunks = nb_chunks;
+    mmap_lock();
+    table->next = tb_image_tables;
+    tb_image_tables = table;
+    mmap_unlock();
+    return table;
+}
+
+static void tb_image_table_clear(TBImageTable *table)
+{
+    size_t i;
+
+    for (i = 0; i < table->nb_chunks; i++) {
+        if (table->chunks[i]) {
+            memset(table->chunks[i], 0,
+                   TB_IMAGE_CHUNK_ENTRIES * sizeof(TranslationBlock *));
+        }
+    }
+}
+
+/* Called once the image of @table has been removed from the image map. */
+void tb_image_table_retire(TBImageTable *table)
+{
+    mmap_lock();
+    atomic_set(&table->dead, true);
+    tb_image_table_clear(table);
+    mmap_unlock();
+    if (tb_image_last == table) {
+        tb_image_last = NULL;
+    }
+}
+
+static TBImageTable *tb_image_table_find(target_ulong pc)
+{
+    TBImageTable *table = tb_image_last;
+    ImageRange range;
+
+    if (table && pc - table->base < table->size && !atomic_read(&table->dead)) {
+        return table;
+    }
+    if (!image_map_lookup(pc, &range) || range.tb_table == NULL) {
+        return NULL;
+    }
+    table = range.tb_table;
+    if (pc - table->base >= table->size || atomic_read(&table->dead)) {
+        return NULL;
+    }
+    tb_image_last = table;
+    return table;
+}
+
+static TranslationBlock **tb_image_entry(TBImageTable *table, target_ulong pc,
+                                         bool alloc)
+{
+    TranslationBlock **chunk;
+    target_ulong index;
+
+    index = (pc - table->base) >> 2;
+    chunk = atomic_rcu_read(&table->chunks[index / TB_IMAGE_CHUNK_ENTRIES]);
+    if (chunk == NULL) {
+        if (!alloc) {
+            return NULL;
+        }
+        /* writers hold mmap_lock, no need for a cmpxchg */
+        chunk = g_new0(TranslationBlock *, TB_IMAGE_CHUNK_ENTRIES);
+        atomic_rcu_set(&table->chunks[index / TB_IMAGE_CHUNK_ENTRIES], chunk);
+    }
+    return &chunk[index % TB_IMAGE_CHUNK_ENTRIES];
+}
+
+TranslationBlock *tb_image_lookup(target_ulong pc)
+{
+    TBImageTable *table;
+    TranslationBlock **entry;
+    TranslationBlock *tb;
+
+    if (pc & 3) {
+        return NULL;
+    }
+    table = tb_image_table_find(pc);
+    if (table == NULL) {
+        return NULL;
+    }
+    entry = tb_image_entry(table, pc, false);
+    if (entry == NULL) {
+        return NULL;
+    }
+    tb = atomic_rcu_read(entry);
+    if (tb && tb->pc == pc && !(tb_cflags(tb) & CF_INVALID)) {
+        return tb;
+    }
+    return NULL;
+}
+
+static void tb_image_insert(TranslationBlock *tb)
+{
+    TBImageTable *table;
+
+    assert_memory_lock();
+    if (tb->pc & 3) {
+        return;
+    }
+    table = tb_image_table_find(tb->pc);
+    if (table) {
+        atomic_rcu_set(tb_image_entry(table, tb->pc, true), tb);
+        tb->image_table = table;
+    }
+}
+
+static void tb_image_remove(TranslationBlock *tb)
+{
+    TranslationBlock **entry;
+
+    assert_memory_lock();
+    if (tb->image_table == NULL) {
+        return;
+    }
+    entry = tb_image_entry(tb->image_table, tb->pc, false);
+    if (entry && atomic_read(entry) == tb) {
+        atomic_set(entry, NULL);
+    }
+    tb->image_table = NULL;
+}
+
+static void tb_image_flush(void)
+{
+    TBImageTable *table;
+
+    for (table = tb_image_tables; table; table = table->next) {
+        tb_image_table_clear(table);
+    }
+}
+
 /* flush all the translation blocks */
 static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 {
@@ -1223,6 +1390,7 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
     }
 
     qht_reset_size(&tb_ctx.htable, CODE_GEN_HTABLE_SIZE);
+    tb_image_flush();
     page_flush_tb();
 
     tcg_region_reset_all();
@@ -1424,6 +1592,7 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
         !qht_remove(&tb_ctx.htable, tb, h)) {
         return;
     }
+    tb_image_remove(tb);
 
     /* remove the TB from the page list */
     if (rm_from_page_list) {
@@ -1627,6 +1796,8 @@ tb_link_page(TranslationBlock *tb, tb_page_addr_t phys_pc,
                 invalidate_page_bitmap(p2);
             }
             tb = existing_tb;
+        } else {
+            tb_image_insert(tb);
         }
     }
 
@@ -2018,6 +2189,7 @@ register_pc_with_handler(target_ulong pc, void *handler)
     tb->flags = 0;
     tb->cflags = 0;
     tb->orig_tb = NULL;
+    tb->image_table = NULL;
     tb->trace_vcpu_dstate = 0;
     tcg_ctx->tb_cflags = 0;
 
@@ -2076,6 +2248,7 @@ register_pc_with_handler(target_ulong pc, void *handler)
 
 extern const char *default_method_types;
 extern const char *tcg_query_callback_type(target_ulong pc);
+extern const char *tcg_query_callback_type_nolock(target_ulong pc);
 
 #if DBG_RECORD_ASM_PAIR == 1
 extern GHashTable *dbg_in_out;
@@ -2084,6 +2257,22 @@ extern GHashTable *dbg_pending_bps;
 extern void dbg_remove_pending_bps(uint64_t in, uint64_t out);
 #endif
 
+unsigned int tb_tier_threshold;
+
+/*
+ * Called from a CF_TIER0 TB whose execution counter ran out.  Remember the
+ * pc as hot and drop the TB; the next lookup misses and retranslates it
+ * without CF_TIER0.  The code of the invalidated TB stays in the buffer,
+ * so the caller can safely finish executing it.
+ */
+void tb_tier_up(TranslationBlock *tb)
+{
+    mmap_lock();
+    g_hash_table_add(tcg_ctx->tier1_pcs, (gpointer)tb->pc);
+    tb_phys_invalidate(tb, -1);
+    mmap_unlock();
+}
+
 /* Called with mmap_lock held for user mode emulation.  */
 static TranslationBlock *
 tb_gen_code_internal(CPUState *cpu, target_ulong pc,
@@ -2116,6 +2305,11 @@ tb_gen_code_internal(CPUState *cpu, target_ulong pc,
     cflags &= ~CF_CLUSTER_MASK;
     cflags |= cpu->cluster_index << CF_CLUSTER_SHIFT;
 
+    if (jit && tb_tier_threshold && !(cflags & CF_NOCACHE) &&
+        !g_hash_table_contains(tcg_ctx->tier1_pcs, (gconstpointer)pc)) {
+        cflags |= CF_TIER0;
+    }
+
     max_insns = cflags & CF_COUNT_MASK;
     if (max_insns == 0) {
         max_insns = CF_COUNT_MASK;
@@ -2143,7 +2337,9 @@ tb_gen_code_internal(CPUState *cpu, target_ulong pc,
     tb->flags = flags;
     tb->cflags = cflags;
     tb->orig_tb = NULL;
+    tb->image_table = NULL;
     tb->trace_vcpu_dstate = *cpu->trace_dstate;
+    tb->tier_count = tb_tier_threshold;
     tcg_ctx->tb_cflags = cflags;
  tb_overflow:
     
@@ -2328,6 +2524,141 @@ tb_gen_code_internal(CPUState *cpu, target_ulong pc,
     return tb;
 }
 
+/*
+ * How tb_gen_code() found the stub of a native (x86_64) pc. Except for
+ * objc_msgSend hints and returns to cpu_xloop, which depend on the
+ * running state rather than on the pc, the result is recorded in
+ * native_pcs, so the pc needs a single lock-free lookup from then on. A
+ * later tcg_register_callback_as_type() for the pc drops the record (see
+ * native_pc_forget), e.g. to replace the default objc method types.
+ */
+typedef enum NativePCKind {
+    NATIVE_PC_OBJC_HINT,        /* objc_msgSend family, by receiver */
+    NATIVE_PC_XLOOP_RET,        /* return to cpu_xloop */
+    NATIVE_PC_SYMBOL,           /* bound symbol with a prototype */
+    NATIVE_PC_CALLBACK_TYPES,   /* callback registered with type encodings */
+    NATIVE_PC_CALLBACK_NAME,    /* callback registered with a fake name */
+    NATIVE_PC_DYLD_SYMBOL,      /* symbol solved by asking dyld */
+    NATIVE_PC_UNRECORDED_OBJC,  /* objc method, default method types */
+    NATIVE_PC_CACHED,           /* found in native_pcs */
+    NATIVE_PC_KIND_COUNT,
+} NativePCKind;
+
+static const char * const native_pc_kind_names[NATIVE_PC_KIND_COUNT] = {
+    [NATIVE_PC_OBJC_HINT] = "objc hint",
+    [NATIVE_PC_XLOOP_RET] = "xloop ret",
+    [NATIVE_PC_SYMBOL] = "symbol",
+    [NATIVE_PC_CALLBACK_TYPES] = "callback types",
+    [NATIVE_PC_CALLBACK_NAME] = "callback name",
+    [NATIVE_PC_DYLD_SYMBOL] = "dyld symbol",
+    [NATIVE_PC_UNRECORDED_OBJC] = "unrecorded objc",
+    [NATIVE_PC_CACHED] = "cached",
+};
+
+typedef struct NativePCDesc {
+    target_ulong pc;
+    NativePCKind kind;
+    void *stub;
+    size_t size;
+} NativePCDesc;
+
+/*
+ * Stubs are never flushed and the table does not auto-resize, so lookups
+ * need neither mmap_lock nor RCU. Entries are only removed when a callback
+ * is registered over a pc, which is rare; their descriptors are leaked as
+ * a concurrent lookup may still be reading them.
+ */
+#define NATIVE_PC_HTABLE_SIZE (1 << 16)
+
+static struct qht native_pcs;
+static size_t native_pc_stats[NATIVE_PC_KIND_COUNT];
+
+static bool native_pc_cmp(const void *a, const void *b)
+{
+    const NativePCDesc *x = a;
+    const NativePCDesc *y = b;
+    return x->pc == y->pc;
+}
+
+static void __attribute__((constructor)) native_pc_init(void)
+{
+    qht_init(&native_pcs, native_pc_cmp, NATIVE_PC_HTABLE_SIZE,
+             QHT_MODE_RAW_MUTEXES);
+}
+
+static NativePCDesc *native_pc_lookup(target_ulong pc)
+{
+    NativePCDesc desc = { .pc = pc };
+    return qht_lookup(&native_pcs, &desc, qemu_xxhash2(pc));
+}
+
+static void native_pc_insert(target_ulong pc, NativePCKind kind,
+                             void *stub, size_t size)
+{
+    NativePCDesc *desc = g_new(NativePCDesc, 1);
+
+    desc->pc = pc;
+    desc->kind = kind;
+    desc->stub = stub;
+    desc->size = size;
+    if (!qht_insert(&native_pcs, desc, qemu_xxhash2(pc), NULL)) {
+        /* another thread got there first */
+        g_free(desc);
+    }
+}
+
+/*
+ * Each unrecorded objc callback is only seen once per pc thanks to
+ * native_pcs, but apps may have plenty of them. Log a summary when the
+ * count reaches a power of two, and the details with "-d bridge".
+ */
+static void native_pc_warn_unrecorded_objc(target_ulong pc, const char *name)
+{
+    static size_t count;
+    size_t n = atomic_inc_fetch(&count);
+
+    if (qemu_loglevel_mask(LOG_ABI_BRIDGE)) {
+        qemu_log("WARNING: unrecorded objc callback: 0x%llx %s!\n",
+                 (uint64_t)pc, name);
+    } else if (is_power_of_2(n)) {
+        qemu_log("WARNING: %zu unrecorded objc callbacks so far, "
+                 "latest 0x%llx %s\n", n, (uint64_t)pc, name);
+    }
+}
+
+/*
+ * Called with mmap_lock held from tcg_register_callback_as_type(), the
+ * types of @pc may have changed.
+ */
+void native_pc_forget(target_ulong pc)
+{
+    NativePCDesc *desc = native_pc_lookup(pc);
+
+    if (desc) {
+        qht_remove(&native_pcs, desc, qemu_xxhash2(pc));
+    }
+}
+
+static void native_pc_dump_info(void)
+{
+    int i;
+
+    qemu_printf("\nNative pc resolutions:\n");
+    for (i = 0; i < NATIVE_PC_KIND_COUNT; i++) {
+        qemu_printf("%-19s %zu\n", native_pc_kind_names[i],
+                    atomic_read(&native_pc_stats[i]));
+    }
+}
+
+static void native_pc_account(target_ulong pc, NativePCKind kind)
+{
+    atomic_inc(&native_pc_stats[kind]);
+    if (kind != NATIVE_PC_CACHED && qemu_loglevel_mask(LOG_ABI_BRIDGE)) {
+        qemu_log("native pc 0x%llx: %s (%zu so far)\n", (uint64_t)pc,
+                 native_pc_kind_names[kind], atomic_read(&native_pc_stats[kind]));
+    }
+}
+
 /* Called withOUT mmap_lock held for user mode emulation.  */
 TranslationBlock *tb_gen_code(CPUState *cpu,
                               target_ulong pc,
@@ -2346,6 +2677,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         void *tb_tc_ptr = NULL;
         size_t tb_tc_size = 0;
         CPUArchState *env = cpu->env_ptr;
+        NativePCDesc *desc;
+        NativePCKind kind = NATIVE_PC_OBJC_HINT;
         
         if (env->code_gen_hints.code_gen_hint_type != CODE_GEN_HINT_NONE &&
             env->code_gen_hints.pc == env->pc) {
@@ -2366,24 +2699,43 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                 tb_tc_ptr = abi_a2x_gen_trampoline_for_types(types, &tb_tc_size);
                 mmap_unlock();
             }
-        } else if (pc == QTAILQ_FIRST(&env->CFIhead)->x64_pc) {
+        } else if (pc == CFIList_First(env)->x64_pc) {
             tb_tc_ptr = tcg_ctx->code_gen_xloop_ret_tb;
+            kind = NATIVE_PC_XLOOP_RET;
+        } else if ((desc = native_pc_lookup(pc)) != NULL) {
+            // resolved before, e.g. prior to a change of cflags
+            tb_tc_ptr = desc->stub;
+            tb_tc_size = desc->size;
+            kind = NATIVE_PC_CACHED;
         } else {
             // Misc functions.
             // Symbol name from non-lazy/lazy binder hooker, or
             // the dlsym function.
+            // callback types seen, if they were queried
+            const char *types = NULL;
+            bool types_queried = false;
+            kind = NATIVE_PC_SYMBOL;
             mmap_lock();
             const char *symbol_name = g_hash_table_lookup(tcg_ctx->addr_to_symbolname, (gconstpointer)pc);
             mmap_unlock();
+            if (NULL == symbol_name && mark_pending_lazy_bind_symbols()) {
+                // lazy binds of some images have not been scanned yet
+                mmap_lock();
+                symbol_name = g_hash_table_lookup(tcg_ctx->addr_to_symbolname, (gconstpointer)pc);
+                mmap_unlock();
+            }
             if (NULL == symbol_name) {
                 // the pc may be a callback
-                const char *types = tcg_query_callback_type(pc);
+                types = tcg_query_callback_type(pc);
+                types_queried = true;
                 if (types) {
                     mmap_lock();
                     if ('0' == types[0] || '1' == types[0]) {
                         tb_tc_ptr = abi_a2x_gen_trampoline_for_name(types, &tb_tc_size);
+                        kind = NATIVE_PC_CALLBACK_NAME;
                     } else {
                         tb_tc_ptr = abi_a2x_gen_trampoline_for_types(types, &tb_tc_size);
+                        kind = NATIVE_PC_CALLBACK_TYPES;
                     }
                     mmap_unlock();
                 } else {
@@ -2393,6 +2745,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                     * NOTE: Do not hold mmap lock while holding dyld locks.
                     */
                     symbol_name = solve_symbol_name(pc);
+                    kind = NATIVE_PC_DYLD_SYMBOL;
                 }
             }
             if (!tb_tc_ptr) {
@@ -2404,7 +2757,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                     mmap_lock();
                     tb_tc_ptr = abi_a2x_gen_trampoline_for_types(default_method_types, &tb_tc_size);
                     mmap_unlock();
-                    qemu_log("WARNING: unrecorded objc callback: 0x%llx %s!\n", pc, symbol_name);
+                    kind = NATIVE_PC_UNRECORDED_OBJC;
+                    native_pc_warn_unrecorded_objc(pc, symbol_name);
                 } else {
                     mmap_lock();
                     tb_tc_ptr = abi_a2x_gen_trampoline_for_name(symbol_name, &tb_tc_size);
@@ -2416,7 +2770,17 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                 mmap_unlock();
 #endif
             }
+            /*
+             * tcg_register_callback_as_type() forgets the pc under
+             * mmap_lock; do not record a result it made stale meanwhile.
+             */
+            mmap_lock();
+            if (!types_queried || tcg_query_callback_type_nolock(pc) == types) {
+                native_pc_insert(pc, kind, tb_tc_ptr, tb_tc_size);
+            }
+            mmap_unlock();
         }
+        native_pc_account(pc, kind);
         
         mmap_lock();
         ret = tb_gen_code_internal(cpu, pc, flags, cflags, tb_tc_ptr, tb_tc_size);
@@ -2484,6 +2848,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->flags = flags;
     tb->cflags = cflags;
     tb->orig_tb = NULL;
+    tb->image_table = NULL;
     tb->trace_vcpu_dstate = *cpu->trace_dstate;
     tcg_ctx->tb_cflags = cflags;
  tb_overflow:
@@ -2623,7 +2988,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
             }
             env->code_gen_hints.code_gen_hint_type = CODE_GEN_HINT_NONE;
             tb->tc.ptr = abi_a2x_gen_trampoline_for_types(types, pc);
-        } else if(pc == QTAILQ_FIRST(&env->CFIhead)->x64_pc) {
+        } else if(pc == CFIList_First(env)->x64_pc) {
             tb->tc.ptr = tcg_ctx->code_gen_xloop_ret_tb;
         /*
          * Misc functions.
@@ -3080,6 +3445,8 @@ void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
     tb_jmp_cache_clear_page(cpu, addr);
 }
 
+#endif /* !CONFIG_USER_ONLY */
+
 static void print_qht_statistics(struct qht_stats hst)
 {
     uint32_t hgram_opts;
@@ -3154,7 +3521,10 @@ void dump_exec_info(void)
 {
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
-    size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t nb_tbs;
+#ifndef CONFIG_USER_ONLY
+    size_t flush_full, flush_part, flush_elide;
+#endif
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -3192,10 +3562,15 @@ void dump_exec_info(void)
     qemu_printf("TB invalidate count %zu\n",
                 tcg_tb_phys_invalidate_count());
 
+#ifdef CONFIG_USER_ONLY
+    native_pc_dump_info();
+    guest_stack_dump_info();
+#else
     tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
     qemu_printf("TLB full flushes    %zu\n", flush_full);
     qemu_printf("TLB partial flushes %zu\n", flush_part);
     qemu_printf("TLB elided flushes  %zu\n", flush_elide);
+#endif
     tcg_dump_info();
 }
 
@@ -3204,7 +3579,7 @@ void dump_opcount_info(void)
     tcg_dump_op_count();
 }
 
-#else /* CONFIG_USER_ONLY */
+#ifdef CONFIG_USER_ONLY
 
 void cpu_interrupt(CPUState *cpu, int mask)
 {
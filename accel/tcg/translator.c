@@ -15,6 +15,7 @@
 #include "tcg/tcg-op.h"
 #include "exec/exec-all.h"
 #include "exec/gen-icount.h"
+#include "exec/helper-gen.h"
 #include "exec/log.h"
 #include "exec/translator.h"
 #include "exec/plugin-gen.h"
@@ -33,6 +34,37 @@ void translator_loop_temp_check(DisasContextBase *db)
     }
 }
 
+/*
+ * Count down tb->tier_count on each execution of a CF_TIER0 TB and ask for
+ * retranslation when it reaches zero.  Emitted ahead of everything else
+ * in the TB, as the branch ends the lifetime of ordinary temps.  The
+ * helper call is a cold region, out of the way of the fast path.
+ */
+static void gen_tb_tier_count(TranslationBlock *tb)
+{
+    TCGLabel *hot = gen_new_label();
+    TCGLabel *warm = gen_new_label();
+    TCGv_ptr ptr = tcg_const_ptr(&tb->tier_count);
+    TCGv_i32 left = tcg_temp_new_i32();
+
+    tcg_gen_ld_i32(left, ptr, 0);
+    tcg_gen_subi_i32(left, left, 1);
+    tcg_gen_st_i32(left, ptr, 0);
+    tcg_gen_brcondi_i32(TCG_COND_EQ, left, 0, hot);
+    tcg_temp_free_i32(left);
+    tcg_temp_free_ptr(ptr);
+
+    tcg_gen_cold_start();
+    gen_set_label(hot);
+    ptr = tcg_const_ptr(tb);
+    gen_helper_tier_up(ptr);
+    tcg_temp_free_ptr(ptr);
+    tcg_gen_br(warm);
+    tcg_gen_cold_end();
+
+    gen_set_label(warm);
+}
+
 #if DBG_RECORD_ASM_PAIR == 1
 extern target_ulong dbg_in;
 extern target_ulong aarch64_pc_first(DisasContextBase *dcbase);
@@ -60,6 +92,9 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     tcg_clear_temp_count();
 
     /* Start translating.  */
+    if (tb_cflags(db->tb) & CF_TIER0) {
+        gen_tb_tier_count(db->tb);
+    }
     gen_tb_start(db->tb);
     ops->tb_start(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
@@ -17,6 +17,8 @@
 
 #include "qemu/osdep.h"
 #include "qemu.h"
+#include "qemu/qht.h"
+#include "qemu/xxhash.h"
 #include <Block.h>
 
 static struct Block_descriptor_2 *
@@ -63,23 +65,207 @@ block_get_copy_dispose(struct Block_layout *block, void (**copy)(void *dst, cons
     *dispose = bd2->dispose;
 }
 
+/*
+ * Heap copies of block descriptors, keyed by the original descriptor. All
+ * blocks created from the same literal share one descriptor, and the
+ * trampolines installed into its copy/dispose slots only depend on the
+ * original callbacks, so one copy per original descriptor is enough. Heap
+ * copies of global blocks are cached by source address (see BlockBridge)
+ * for the same reason. Neither is ever freed, but both are bounded by the
+ * number of block literals in the guest images instead of the number of
+ * dispatched blocks. Entries keyed by an address of an unloaded image are
+ * dropped by block_copy_purge_range(). Protected by mmap_lock, which also
+ * guards the trampoline tables the fixup callback adds to.
+ */
+static GHashTable *block_descriptors;
+static size_t block_descriptor_bytes;
+// block descriptors locate in const segment. Each one is copied to heap
+// with room for all three parts.
+static const size_t block_descriptor_copy_size =
+    sizeof(struct Block_descriptor_1) +
+    sizeof(struct Block_descriptor_2) +
+    sizeof(struct Block_descriptor_3);
+static unsigned int global_block_count;
+static size_t global_block_bytes;
+
+/*
+ * A fully bridged block: what block_copy_to_heap_or_not() ended up with
+ * for a given global block, or for a given (descriptor, invoke) pair of a
+ * stack or malloc block. Repeated dispatches of the same literal are
+ * resolved with one lookup, without taking mmap_lock or allocating.
+ * Entries are only added (under mmap_lock) once the fixup is complete, and
+ * the table is never resized, so readers need no lock. Entries are removed
+ * when their image is unloaded, but not freed, as a reader may still hold
+ * them.
+ */
+typedef struct BlockBridge {
+    const void *orig;                   /* global block, or descriptor */
+    BlockInvokeFunction orig_invoke;    /* NULL for global blocks */
+    void *bridged;                      /* heap block, or heap descriptor */
+    BlockInvokeFunction invoke;
+} BlockBridge;
+
+#define BLOCK_BRIDGE_HTABLE_SIZE (1 << 12)
+
+static struct qht block_bridges;
+
+static bool
+block_bridge_cmp(const void *a, const void *b)
+{
+    const BlockBridge *x = a;
+    const BlockBridge *y = b;
+    return x->orig == y->orig && x->orig_invoke == y->orig_invoke;
+}
+
+static void __attribute__((constructor))
+block_bridge_init(void)
+{
+    qht_init(&block_bridges, block_bridge_cmp, BLOCK_BRIDGE_HTABLE_SIZE,
+             QHT_MODE_RAW_MUTEXES);
+}
+
+static inline uint32_t
+block_bridge_hash(const void *orig, BlockInvokeFunction orig_invoke)
+{
+    return qemu_xxhash4((uintptr_t)orig, (uintptr_t)orig_invoke);
+}
+
+static void
+block_bridge_key(BlockBridge *key, struct Block_layout *src)
+{
+    if (&_NSConcreteGlobalBlock == src->isa) {
+        key->orig = src;
+        key->orig_invoke = NULL;
+    } else {
+        key->orig = src->descriptor;
+        key->orig_invoke = src->invoke;
+    }
+}
+
+static struct Block_layout *
+block_bridge_lookup(struct Block_layout *src)
+{
+    BlockBridge key;
+    block_bridge_key(&key, src);
+    
+    BlockBridge *e = qht_lookup(&block_bridges, &key,
+                                block_bridge_hash(key.orig, key.orig_invoke));
+    if (NULL == e)
+        return NULL;
+    
+    if (NULL == e->orig_invoke) {
+        // global block
+        return e->bridged;
+    }
+    src->descriptor = e->bridged;
+    src->invoke = e->invoke;
+    return src;
+}
+
 static void
+block_bridge_insert(const BlockBridge *key, struct Block_layout *dst)
+{
+    BlockBridge *e = g_new(BlockBridge, 1);
+    // never freed
+    
+    *e = *key;
+    if (NULL == key->orig_invoke) {
+        e->bridged = dst;
+    } else {
+        e->bridged = dst->descriptor;
+    }
+    e->invoke = dst->invoke;
+    
+    qht_insert(&block_bridges, e, block_bridge_hash(e->orig, e->orig_invoke), NULL);
+}
+
+typedef struct BlockPurgeRange {
+    uintptr_t start;
+    uintptr_t end;
+} BlockPurgeRange;
+
+static gboolean
+block_descriptor_in_range(gpointer key, gpointer value, gpointer opaque)
+{
+    const BlockPurgeRange *r = opaque;
+    if ((uintptr_t)key - r->start >= r->end - r->start)
+        return FALSE;
+    
+    // the copy stays allocated, but it no longer counts as cached
+    block_descriptor_bytes -= block_descriptor_copy_size;
+    return TRUE;
+}
+
+static bool
+block_bridge_in_range(void *p, uint32_t h, void *opaque)
+{
+    const BlockBridge *e = p;
+    const BlockPurgeRange *r = opaque;
+    if ((uintptr_t)e->orig - r->start >= r->end - r->start)
+        return false;
+    
+    if (NULL == e->orig_invoke) {
+        // global block, see block_copy_to_heap_or_not()
+        global_block_count--;
+        global_block_bytes -= block_get_size_for_heap_copy(e->bridged);
+    }
+    return true;
+}
+
+/*
+ * Called when the image mapping [start, end) is unloaded: forget the
+ * descriptors and global blocks it held, so that a later image mapped at
+ * the same addresses is not bridged with them. The heap copies are not
+ * freed, blocks copied from them may still be alive.
+ */
+void
+block_copy_purge_range(uintptr_t start, uintptr_t end)
+{
+    BlockPurgeRange r = { .start = start, .end = end };
+    
+    mmap_lock();
+    if (block_descriptors) {
+        g_hash_table_foreach_remove(block_descriptors, block_descriptor_in_range, &r);
+    }
+    qht_iter_remove(&block_bridges, block_bridge_in_range, &r);
+    mmap_unlock();
+}
+
+static void
+block_copy_log_usage(void)
+{
+    if (!qemu_loglevel_mask(LOG_STATS))
+        return;
+    qemu_log("block copies: %u descriptors (%zu bytes), %u global blocks (%zu bytes)\n",
+             g_hash_table_size(block_descriptors), block_descriptor_bytes,
+             global_block_count, global_block_bytes);
+}
+
+// returns true if a new descriptor copy has been created for dst
+static bool
 my_block_copy(struct Block_layout *dst, struct Block_layout *src)
 {
+    struct Block_descriptor_1 *src_bd = src->descriptor;
+    
     // block body
     if (dst != src)
-        memmove(dst, src, src->descriptor->size);
+        memmove(dst, src, src_bd->size);
     
-    // block descriptors locate in const segment. Copy them to heap.
-    static size_t bd_size = sizeof(struct Block_descriptor_1) +
-        sizeof(struct Block_descriptor_2) +
-        sizeof(struct Block_descriptor_3);
-    struct Block_descriptor_1 *heap_bd = (struct Block_descriptor_1 *)g_malloc0(bd_size);
-    // never freed
+    if (NULL == block_descriptors) {
+        block_descriptors = g_hash_table_new(NULL, NULL);
+    }
+    struct Block_descriptor_1 *heap_bd = g_hash_table_lookup(block_descriptors, src_bd);
+    if (heap_bd) {
+        dst->descriptor = heap_bd;
+        return false;
+    }
+    
+    heap_bd = (struct Block_descriptor_1 *)g_malloc0(block_descriptor_copy_size);
+    // never freed, shared by every block with the same descriptor
     
     uint8_t *u8d = (uint8_t *)heap_bd;
     // bd1
-    memcpy(u8d, src->descriptor, sizeof(struct Block_descriptor_1));
+    memcpy(u8d, src_bd, sizeof(struct Block_descriptor_1));
     u8d += sizeof(struct Block_descriptor_1);
     // bd2
     struct Block_descriptor_2 *src_bd2 = block_get_descriptor2(src);
@@ -94,7 +280,11 @@ my_block_copy(struct Block_layout *dst, struct Block_layout *src)
         // u8d += sizeof(struct Block_descriptor_3);
     }
     
+    g_hash_table_insert(block_descriptors, src_bd, heap_bd);
+    block_descriptor_bytes += block_descriptor_copy_size;
+    
     dst->descriptor = heap_bd;
+    return true;
 }
 
 static void
@@ -187,29 +377,70 @@ block_copy_to_stack_or_heap(uint8_t *u8dst, struct Block_layout *src)
         *dst_ptr = dst;
     }
     
+    mmap_lock();
     my_block_copy(dst, src);
+    mmap_unlock();
     return dst;
 }
 
+/**
+ * block_copy_to_heap_or_not:
+ * @param fixup: called with mmap_lock held the first time an emulated block
+ * literal is seen, to replace its callbacks. Copy and dispose only need to
+ * be replaced when @new_descriptor is set, i.e. the descriptor has not been
+ * seen before. The result is cached, so all callers must pass the same
+ * fixup. Blocks with x86_64 callbacks are not copied, but still go through
+ * fixup (without mmap_lock) so that their callbacks are known to the
+ * translator.
+ * @return: the copied block
+ */
 struct Block_layout *
-block_copy_to_heap_or_not(struct Block_layout *src)
+block_copy_to_heap_or_not(struct Block_layout *src, BlockFixupFunction fixup)
 {
     if (NULL == src)
         return NULL;
     
+    // fast path: this literal has been bridged before
+    struct Block_layout *dst = block_bridge_lookup(src);
+    if (dst)
+        return dst;
+    
     if (!need_emulation((uintptr_t)src->invoke)) {
+        fixup(src, true);
         return src;
     }
     
-    struct Block_layout *dst = NULL;
+    mmap_lock();
+    
+    // another thread may have bridged this literal, or fixed up this very
+    // block in place, meanwhile
+    dst = block_bridge_lookup(src);
+    if (dst || !need_emulation((uintptr_t)src->invoke)) {
+        mmap_unlock();
+        return dst ? dst : src;
+    }
+    
+    BlockBridge key;
+    block_bridge_key(&key, src);
+    
     if (&_NSConcreteGlobalBlock == src->isa) {
-        dst = (struct Block_layout *)g_malloc0(block_get_size_for_heap_copy(src));
-        // never freed
+        size_t size = block_get_size_for_heap_copy(src);
+        dst = (struct Block_layout *)g_malloc0(size);
+        // never freed, cached by source address
+        global_block_count++;
+        global_block_bytes += size;
     } else {
         dst = src;
     }
     
-    my_block_copy(dst, src);
+    bool new_descriptor = my_block_copy(dst, src);
+    fixup(dst, new_descriptor);
+    block_bridge_insert(&key, dst);
+    if (new_descriptor) {
+        block_copy_log_usage();
+    }
+    
+    mmap_unlock();
     return dst;
 }
 
@@ -37,12 +37,7 @@ EXPORT
 int *       iqemu_get_jmp_buf(int index)
 {
     CPUArchState *env = thread_cpu->env_ptr;
-    CFIEntry *cfi = QTAILQ_FIRST(&env->CFIhead);
-    
-    while(index > 0 && cfi) {
-        index --;
-        cfi = QTAILQ_NEXT(cfi, link);
-    }
+    CFIEntry *cfi = CFIList_Get(env, index);
     
     if(NULL == cfi) {
         return NULL;
@@ -112,15 +107,10 @@ EXPORT
 bool        iqemu_get_x64_CFI(int index, uintptr_t *sp, uintptr_t *fp)
 {
     CPUArchState *env = thread_cpu->env_ptr;
-    CFIEntry *cfi = QTAILQ_FIRST(&env->CFIhead);
+    CFIEntry *cfi = CFIList_Get(env, index);
     *sp = 0;
     *fp = 0;
     
-    while(index > 0 && cfi) {
-        index --;
-        cfi = QTAILQ_NEXT(cfi, link);
-    }
-    
     if(NULL == cfi)
         return false;
     
@@ -133,16 +123,11 @@ EXPORT
 bool        iqemu_get_arm64_CFI(int index, uintptr_t *sp, uintptr_t *fp, uintptr_t *pc)
 {
     CPUArchState *env = thread_cpu->env_ptr;
-    CFIEntry *cfi = QTAILQ_FIRST(&env->CFIhead);
+    CFIEntry *cfi = CFIList_Get(env, index);
     *sp = 0;
     *fp = 0;
     *pc = 0;
     
-    while(index > 0 && cfi) {
-        index --;
-        cfi = QTAILQ_NEXT(cfi, link);
-    }
-    
     if(NULL == cfi)
         return false;
     
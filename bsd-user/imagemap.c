@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2020 上海芯竹科技有限公司
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/atomic.h"
+#include "qemu/seqlock.h"
+#include "qemu/thread.h"
+
+#include "imagemap.h"
+
+/*
+ * The images are kept in an array sorted by start address. Writers are
+ * serialized by a mutex and update the array in place inside a seqlock
+ * write section; readers search it and retry if a write happened
+ * meanwhile. When the array is full it is replaced by one twice as big.
+ * Readers may still be looking at the old one, so it is never freed: the
+ * arrays ever published take at most twice the space of the last one.
+ */
+typedef struct ImageRangeArray {
+    int capacity;
+    ImageRange ranges[];
+} ImageRangeArray;
+
+#define IMAGE_MAP_INIT_SIZE 512
+
+static struct {
+    QemuMutex lock;
+    QemuSeqLock sequence;
+    ImageRangeArray *array;
+    int count;
+} image_map;
+
+static void __attribute__((constructor))
+image_map_init(void)
+{
+    qemu_mutex_init(&image_map.lock);
+    seqlock_init(&image_map.sequence);
+    image_map.array = g_malloc(sizeof(ImageRangeArray) +
+                               IMAGE_MAP_INIT_SIZE * sizeof(ImageRange));
+    image_map.array->capacity = IMAGE_MAP_INIT_SIZE;
+}
+
+/* index of the first image whose end is above @addr */
+static int image_map_search(const ImageRange *ranges, int count, uintptr_t addr)
+{
+    int lo = 0, hi = count;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (ranges[mid].end <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool image_map_add(const ImageRange *range)
+{
+    ImageRangeArray *array;
+    int i;
+
+    if (range->start >= range->end) {
+        return false;
+    }
+
+    qemu_mutex_lock(&image_map.lock);
+    array = image_map.array;
+    i = image_map_search(array->ranges, image_map.count, range->start);
+    /*
+     * ranges[i] is the first image ending above our start; the search
+     * relies on the images being disjoint, so refuse anything that would
+     * overlap it (this includes adding the same image twice).
+     */
+    if (i < image_map.count && array->ranges[i].start < range->end) {
+        qemu_mutex_unlock(&image_map.lock);
+        return false;
+    }
+
+    if (image_map.count == array->capacity) {
+        ImageRangeArray *grown = g_malloc(sizeof(ImageRangeArray) +
+                                          2 * array->capacity * sizeof(ImageRange));
+        grown->capacity = 2 * array->capacity;
+        memcpy(grown->ranges, array->ranges, image_map.count * sizeof(ImageRange));
+        /* the old array is leaked on purpose, see above */
+        array = grown;
+    }
+
+    seqlock_write_begin(&image_map.sequence);
+    memmove(&array->ranges[i + 1], &array->ranges[i],
+            (image_map.count - i) * sizeof(ImageRange));
+    array->ranges[i] = *range;
+    atomic_set(&image_map.array, array);
+    atomic_set(&image_map.count, image_map.count + 1);
+    seqlock_write_end(&image_map.sequence);
+    qemu_mutex_unlock(&image_map.lock);
+    return true;
+}
+
+bool image_map_remove(const void *header, ImageRange *removed)
+{
+    ImageRangeArray *array;
+    int i;
+
+    qemu_mutex_lock(&image_map.lock);
+    array = image_map.array;
+    /* images are keyed on their __TEXT, which starts at the header */
+    i = image_map_search(array->ranges, image_map.count, (uintptr_t)header);
+    if (i == image_map.count || array->ranges[i].header != header) {
+        qemu_mutex_unlock(&image_map.lock);
+        return false;
+    }
+    if (removed) {
+        *removed = array->ranges[i];
+    }
+    seqlock_write_begin(&image_map.sequence);
+    memmove(&array->ranges[i], &array->ranges[i + 1],
+            (image_map.count - i - 1) * sizeof(ImageRange));
+    atomic_set(&image_map.count, image_map.count - 1);
+    seqlock_write_end(&image_map.sequence);
+    qemu_mutex_unlock(&image_map.lock);
+    return true;
+}
+
+bool image_map_lookup(uintptr_t addr, ImageRange *range)
+{
+    unsigned start;
+    bool found;
+
+    do {
+        start = seqlock_read_begin(&image_map.sequence);
+
+        ImageRangeArray *array = atomic_rcu_read(&image_map.array);
+        int count = MIN(atomic_read(&image_map.count), array->capacity);
+        int i = image_map_search(array->ranges, count, addr);
+
+        found = i < count && array->ranges[i].start <= addr;
+        if (found) {
+            *range = array->ranges[i];
+        }
+    } while (seqlock_read_retry(&image_map.sequence, start));
+
+    return found;
+}
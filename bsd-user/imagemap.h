@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2020 上海芯竹科技有限公司
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef imagemap_h
+#define imagemap_h
+
+/*
+ * Address ranges of the loaded images, maintained from the dyld image
+ * add/remove callbacks. Lookups are a binary search that takes no lock,
+ * so it can replace dladdr() and friends, which take dyld's global lock
+ * and walk every image, on translation and crossing paths.
+ *
+ * This file does not depend on Mach-O headers; filling an ImageRange from
+ * a mach header is done in iosload.c.
+ */
+typedef struct ImageRange {
+    uintptr_t start;            /* __TEXT, which starts at header */
+    uintptr_t end;              /* end of __TEXT */
+    const void *header;
+    uintptr_t text_size;        /* __TEXT starts at header */
+    uintptr_t linkedit_base;
+    uintptr_t linkedit_size;
+    intptr_t slide;
+    bool foreign;               /* an ARM image */
+    bool executable;            /* MH_EXECUTE */
+    void *loader;               /* dyld's ImageLoader, may be NULL */
+    void *tb_table;             /* TBImageTable of a foreign image's __TEXT */
+} ImageRange;
+
+/*
+ * Only the __TEXT of an image is keyed: the other segments of images in
+ * the dyld shared cache are far from it and __LINKEDIT is shared between
+ * them, so whole-image spans would overlap. Returns false, leaving the
+ * map unchanged, if @range is empty or overlaps an image already in the
+ * map (which includes adding the same image twice).
+ */
+bool image_map_add(const ImageRange *range);
+/* Copy the removed image to @removed, if not NULL. */
+bool image_map_remove(const void *header, ImageRange *removed);
+
+/* Copy the image containing @addr to @range. */
+bool image_map_lookup(uintptr_t addr, ImageRange *range);
+
+#endif /* imagemap_h */
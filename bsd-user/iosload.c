@@ -155,7 +155,12 @@ solve_symbol_by_header(const struct MACH_HEADER *header, const char *name)
 const char *
 solve_symbol_name(uintptr_t addr)
 {
-    void *imageLoader = g_dyld_funcs.findMappedRange(addr);
+    ImageRange range;
+    void *imageLoader = NULL;
+    if(image_map_lookup(addr, &range))
+        imageLoader = range.loader;
+    if(NULL == imageLoader)
+        imageLoader = g_dyld_funcs.findMappedRange(addr);
     if(imageLoader) {
         const void *saddr;
         const char *symbol_name = g_dyld_funcs.findClosestSymbol(imageLoader, (const void *)addr, &saddr);
@@ -184,9 +189,82 @@ get_mach_header(const void *address)
     {
         return (const struct MACH_HEADER *)g_dyld.base;
     }
+    ImageRange range;
+    if(image_map_lookup((uintptr_t)address, &range)) {
+        return (const struct MACH_HEADER *)range.header;
+    }
     return mydyld_get_image_header_containing_address(address);
 }
 
+/*
+ * Record an image in the image map. Called from the dyld add image
+ * callback, for every image.
+ */
+void
+image_map_add_header(const struct MACH_HEADER *header, intptr_t slide)
+{
+    ImageRange range = {
+        .header = header,
+        .slide = slide,
+        .foreign = is_image_foreign(header),
+        .executable = (header->filetype & 0xFF) == MH_EXECUTE,
+    };
+    uint32_t ncmds = header->ncmds;
+    struct load_command *lcp = (struct load_command *)(header + 1);
+    
+    while(ncmds --) {
+        if(lcp->cmd == LC_SEGMENT_COMMAND) {
+            struct SEGMENT_COMMAND *scp = (struct SEGMENT_COMMAND *)lcp;
+            if(!strcmp(scp->segname, "__TEXT")) {
+                range.text_size = scp->vmsize;
+            } else if(!strcmp(scp->segname, "__LINKEDIT")) {
+                range.linkedit_base = scp->vmaddr + slide;
+                range.linkedit_size = scp->vmsize;
+            }
+        }
+        lcp = (struct load_command *)((uintptr_t)lcp + lcp->cmdsize);
+    }
+    // Keyed on __TEXT only, see imagemap.h.
+    range.start = (uintptr_t)header;
+    range.end = range.start + range.text_size;
+    if(range.start >= range.end)
+        return;
+    
+    range.loader = g_dyld_funcs.findMappedRange((uintptr_t)header);
+    if(range.foreign) {
+        ImageRange existing;
+        if(image_map_lookup((uintptr_t)header, &existing))
+            return;
+        range.tb_table = tb_image_table_new((uintptr_t)header, range.text_size);
+    }
+    if(!image_map_add(&range))
+        qemu_log_mask(LOG_GUEST_ERROR, "image map: %p overlaps a loaded image\n", header);
+}
+
+/*
+ * Drop what the caches keyed by raw guest addresses hold for an image
+ * being unloaded. Called from the dyld remove image callback.
+ */
+void
+image_purge_caches(const struct MACH_HEADER *header, intptr_t slide)
+{
+    uint32_t ncmds = header->ncmds;
+    struct load_command *lcp = (struct load_command *)(header + 1);
+    
+    while(ncmds --) {
+        if(lcp->cmd == LC_SEGMENT_COMMAND) {
+            struct SEGMENT_COMMAND *scp = (struct SEGMENT_COMMAND *)lcp;
+            // skip __PAGEZERO, and __LINKEDIT which the shared cache shares
+            if(scp->vmsize && (scp->initprot || scp->maxprot) &&
+               strcmp(scp->segname, "__LINKEDIT")) {
+                uintptr_t start = scp->vmaddr + slide;
+                block_copy_purge_range(start, start + scp->vmsize);
+            }
+        }
+        lcp = (struct load_command *)((uintptr_t)lcp + lcp->cmdsize);
+    }
+}
+
 extern uintptr_t getLazyBindingInfo;
 extern void __MygetLazyBindingInfo(void);
 
@@ -339,11 +417,24 @@ mydyld_get_image_header_containing_address(const void *addr)
 bool get_address_map(const void *address, target_ulong *base, target_ulong *size,
                      target_ulong *lbase, target_ulong *lsize)
 {
-    struct MACH_HEADER *mach_header = (struct MACH_HEADER *)get_mach_header(address);
-    
     *lbase = 0;
     *lsize = 0;
     
+    ImageRange range;
+    if(image_map_lookup((uintptr_t)address, &range)) {
+        if(!range.executable) {
+            // Not return MH_EXECUTE only.
+            return false;
+        }
+        *base = (target_ulong)range.header;
+        *size = (target_ulong)range.text_size;
+        *lbase = (target_ulong)range.linkedit_base;
+        *lsize = (target_ulong)range.linkedit_size;
+        return true;
+    }
+    
+    struct MACH_HEADER *mach_header = (struct MACH_HEADER *)get_mach_header(address);
+    
     if(mach_header) {
         uint32_t ncmds = mach_header->ncmds;
         if((mach_header->filetype & 0xFF) != MH_EXECUTE) {
@@ -548,36 +639,165 @@ mark_all_section_calls(uintptr_t mach_header,
     }
 }
 
+struct bind_symbol {
+    uintptr_t target;
+    const char *name;
+};
+
+/*
+ * Walking the bind opcodes of an image is the slow part. It only reads
+ * the image, so it is done without mmap_lock into a local batch, which is
+ * then published into addr_to_symbolname in one critical section.
+ */
 static
 void
-mark_all_bind_symbols(void *imageLoader, bool forceLazy)
+collect_bind_symbols(void *imageLoader, bool lazy, GArray *batch)
+{
+    bind_handler handler =
+        ^(const void *context, void *imageLoaderMachOCompressed_image, uintptr_t addr, uint8_t type, const char *symbolName, uint8_t symbolFlags, intptr_t addend, long libraryOrdinal) {
+        struct bind_symbol bs = {
+            .target = *(uintptr_t *)addr,
+            .name = symbolName,
+        };
+        g_array_append_val(batch, bs);
+        return (uintptr_t)0;
+    };
+    
+    if(lazy) {
+        g_dyld_funcs.ImageLoaderMachOCompressed_eachLazyBind(imageLoader, g_dyld_funcs.gLinkContext, handler);
+    } else {
+        g_dyld_funcs.ImageLoaderMachOCompressed_eachBind(imageLoader, g_dyld_funcs.gLinkContext, handler);
+    }
+}
+
+static
+void
+publish_bind_symbols(GArray *batch)
 {
     mmap_lock();
-    g_dyld_funcs.ImageLoaderMachOCompressed_eachBind(imageLoader, g_dyld_funcs.gLinkContext,
-            ^(const void *context, void *imageLoaderMachOCompressed_image, uintptr_t addr, uint8_t type, const char *symbolName, uint8_t symbolFlags, intptr_t addend, long libraryOrdinal) {
-        uintptr_t target = *(uintptr_t *)addr;
-        if(!need_emulation_nolock(target)) {
+    for(guint i = 0; i < batch->len; i++) {
+        struct bind_symbol *bs = &g_array_index(batch, struct bind_symbol, i);
+        if(!need_emulation_nolock(bs->target)) {
             g_hash_table_insert(tcg_ctx->addr_to_symbolname,
-                                (gpointer)target,
-                                (gpointer)symbolName);
+                                (gpointer)bs->target,
+                                (gpointer)bs->name);
         }
-        return (uintptr_t)0;
-    });
-    if(forceLazy) {
-        g_dyld_funcs.ImageLoaderMachOCompressed_eachLazyBind(imageLoader, g_dyld_funcs.gLinkContext,
-            ^(const void *context, void *imageLoaderMachOCompressed_image, uintptr_t addr, uint8_t type, const char *symbolName, uint8_t symbolFlags, intptr_t addend, long libraryOrdinal) {
-            uintptr_t target = *(uintptr_t *)addr;
-            if(!need_emulation_nolock(target)) {
-                g_hash_table_insert(tcg_ctx->addr_to_symbolname,
-                                    (gpointer)target,
-                                    (gpointer)symbolName);
-            }
-            return (uintptr_t)0;
-        });
     }
     mmap_unlock();
 }
 
+/*
+ * Images whose lazy binds still have to be scanned. Nothing needs them
+ * until tb_gen_code fails to find a symbol name, so the scan is deferred
+ * to that point (see mark_pending_lazy_bind_symbols).
+ *
+ * A scan moves the whole queue to lazy_bind_scanning and walks it without
+ * the lock, so image_unload must wait for the scan to finish before dyld
+ * frees an image in it; threads missing a symbol meanwhile wait as well,
+ * as the name they look for may be in the batch being scanned. Both
+ * arrays are protected by lazy_bind_lock.
+ */
+static GPtrArray *pending_lazy_bind_images;
+static GPtrArray *lazy_bind_scanning;
+static QemuMutex lazy_bind_lock;
+static QemuCond lazy_bind_scan_done;
+
+static void __attribute__((constructor))
+lazy_bind_init(void)
+{
+    qemu_mutex_init(&lazy_bind_lock);
+    qemu_cond_init(&lazy_bind_scan_done);
+}
+
+static
+void
+mark_all_bind_symbols(void *imageLoader, bool forceLazy)
+{
+    GArray *batch = g_array_new(FALSE, FALSE, sizeof(struct bind_symbol));
+    
+    collect_bind_symbols(imageLoader, false, batch);
+    publish_bind_symbols(batch);
+    g_array_free(batch, TRUE);
+    
+    if(forceLazy) {
+        qemu_mutex_lock(&lazy_bind_lock);
+        if(NULL == pending_lazy_bind_images) {
+            pending_lazy_bind_images = g_ptr_array_new();
+        }
+        g_ptr_array_add(pending_lazy_bind_images, imageLoader);
+        qemu_mutex_unlock(&lazy_bind_lock);
+    }
+}
+
+/*
+ * Scan the lazy binds of all images deferred by loader_exec. Called
+ * withOUT mmap_lock held. Returns true if any image has been scanned,
+ * by this thread or by one it waited for, in which case a failed
+ * addr_to_symbolname lookup is worth retrying.
+ */
+bool
+mark_pending_lazy_bind_symbols(void)
+{
+    GPtrArray *images;
+    
+    qemu_mutex_lock(&lazy_bind_lock);
+    if(lazy_bind_scanning) {
+        while(lazy_bind_scanning)
+            qemu_cond_wait(&lazy_bind_scan_done, &lazy_bind_lock);
+        qemu_mutex_unlock(&lazy_bind_lock);
+        return true;
+    }
+    images = pending_lazy_bind_images;
+    pending_lazy_bind_images = NULL;
+    lazy_bind_scanning = images;
+    qemu_mutex_unlock(&lazy_bind_lock);
+    
+    if(NULL == images)
+        return false;
+    
+    GArray *batch = g_array_new(FALSE, FALSE, sizeof(struct bind_symbol));
+    for(guint i = 0; i < images->len; i++) {
+        collect_bind_symbols(g_ptr_array_index(images, i), true, batch);
+    }
+    publish_bind_symbols(batch);
+    g_array_free(batch, TRUE);
+    
+    qemu_mutex_lock(&lazy_bind_lock);
+    lazy_bind_scanning = NULL;
+    qemu_cond_broadcast(&lazy_bind_scan_done);
+    qemu_mutex_unlock(&lazy_bind_lock);
+    g_ptr_array_free(images, TRUE);
+    return true;
+}
+
+static
+bool
+lazy_bind_scanning_image(void *imageLoader)
+{
+    if(NULL == lazy_bind_scanning)
+        return false;
+    for(guint i = 0; i < lazy_bind_scanning->len; i++) {
+        if(g_ptr_array_index(lazy_bind_scanning, i) == imageLoader)
+            return true;
+    }
+    return false;
+}
+
+/*
+ * Called from the dyld remove image callback, before dyld frees
+ * @imageLoader: drop it from the queue, or wait for the scan walking it.
+ */
+void
+forget_lazy_bind_image(void *imageLoader)
+{
+    qemu_mutex_lock(&lazy_bind_lock);
+    if(pending_lazy_bind_images)
+        g_ptr_array_remove_fast(pending_lazy_bind_images, imageLoader);
+    while(lazy_bind_scanning_image(imageLoader))
+        qemu_cond_wait(&lazy_bind_scan_done, &lazy_bind_lock);
+    qemu_mutex_unlock(&lazy_bind_lock);
+}
+
 void
 MygetLazyBindingInfo(uint32_t *lazyBindingInfoOffset, const uint8_t *lazyInfoStart,
                      const uint8_t *lazyInfoEnd, uint8_t *segIndex,
@@ -30,6 +30,7 @@
 #include "qemu/error-report.h"
 #include "qemu/path.h"
 #include "qemu/help_option.h"
+#include "qemu/qemu-print.h"
 #include "qemu/module.h"
 #include "cpu.h"
 #include "exec/exec-all.h"
@@ -101,24 +102,124 @@ THREAD TaskState thread_ts;
 static target_ulong pc_page_size = 0, pc_page_base = 0;
 static target_ulong pc_linkedit_size = 0, pc_linkedit_base = 0;
 
-void prepare_env(CPUArchState *env, struct xloop_param *param)
+/*
+ * Guest stacks of exited threads, ready to be handed to new ones. All of
+ * them are guest_stack_size big with the guard page already in place, so
+ * reusing one costs neither a target_mmap nor a target_mprotect. Their
+ * pages are released lazily with MADV_FREE when they are pooled. Protected
+ * by mmap_lock.
+ */
+#define GUEST_STACK_POOL_MAX 64
+
+static abi_ulong guest_stack_pool[GUEST_STACK_POOL_MAX];
+static int guest_stack_pool_count;
+static unsigned int guest_stacks_mapped;
+static unsigned int guest_stacks_in_use;
+
+static pthread_key_t guest_stack_key;
+static pthread_once_t guest_stack_key_once = PTHREAD_ONCE_INIT;
+
+/* with QEMU_LOG=stats; called with mmap_lock held */
+static void guest_stack_log_usage(CPUArchState *env, const char *what)
 {
-    env->xregs[30] = *(uint64_t *)param->unwind_context->rsp;
-    if(env->xregs[31] == 0) {
-        /* virgin. map stack for it. */
-        abi_ulong error = target_mmap(0, guest_stack_size + TARGET_PAGE_SIZE, PROT_READ | PROT_WRITE,
-                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        if (error == -1) {
+    if (!qemu_loglevel_mask(LOG_STATS)) {
+        return;
+    }
+    qemu_log("[%lld] guest stack 0x%llx-0x%llx %s, %u in use, %d pooled, %u mapped (%lu KiB)\n",
+             env_cpu(env)->thread_id, (uint64_t)env->stack_top, (uint64_t)env->stack_bottom,
+             what, guest_stacks_in_use, guest_stack_pool_count, guest_stacks_mapped,
+             guest_stacks_mapped * ((guest_stack_size + TARGET_PAGE_SIZE) >> 10));
+}
+
+/* reported by dump_exec_info() */
+void guest_stack_dump_info(void)
+{
+    mmap_lock();
+    qemu_printf("\nGuest stacks:\n");
+    qemu_printf("in use              %u\n", guest_stacks_in_use);
+    qemu_printf("pooled              %d/%d\n", guest_stack_pool_count,
+                GUEST_STACK_POOL_MAX);
+    qemu_printf("mapped              %u (%lu KiB)\n", guest_stacks_mapped,
+                guest_stacks_mapped * ((guest_stack_size + TARGET_PAGE_SIZE) >> 10));
+    mmap_unlock();
+}
+
+static abi_ulong guest_stack_alloc(bool *reused)
+{
+    abi_ulong stack;
+    
+    /* mmap_lock is held by caller */
+    *reused = guest_stack_pool_count != 0;
+    if (*reused) {
+        stack = guest_stack_pool[--guest_stack_pool_count];
+    } else {
+        stack = target_mmap(0, guest_stack_size + TARGET_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (stack == -1) {
             perror("mmap stack");
             abort();
         }
         
-        env->stack_top = error;
-        
         /* We reserve one extra page at the top of the stack as guard.  */
-        target_mprotect(error, TARGET_PAGE_SIZE, PROT_NONE);
-        env->xregs[31] = error + guest_stack_size + TARGET_PAGE_SIZE;
+        target_mprotect(stack, TARGET_PAGE_SIZE, PROT_NONE);
+        guest_stacks_mapped++;
+    }
+    guest_stacks_in_use++;
+    return stack;
+}
+
+/* called when the native thread owning env exits */
+static void guest_stack_release(void *opaque)
+{
+    CPUArchState *env = opaque;
+    abi_ulong stack = env->stack_top;
+    
+    if (0 == stack)
+        return;
+    
+    mmap_lock();
+    guest_stacks_in_use--;
+    if (guest_stack_pool_count < GUEST_STACK_POOL_MAX) {
+#ifdef MADV_FREE
+        madvise(g2h(stack + TARGET_PAGE_SIZE), guest_stack_size, MADV_FREE);
+#else
+        madvise(g2h(stack + TARGET_PAGE_SIZE), guest_stack_size, MADV_DONTNEED);
+#endif
+        guest_stack_pool[guest_stack_pool_count++] = stack;
+    } else {
+        target_munmap(stack, guest_stack_size + TARGET_PAGE_SIZE);
+        guest_stacks_mapped--;
+    }
+    guest_stack_log_usage(env, "released");
+    env->stack_top = 0;
+    env->stack_bottom = 0;
+    env->xregs[31] = 0;
+    mmap_unlock();
+}
+
+static void guest_stack_key_init(void)
+{
+    pthread_key_create(&guest_stack_key, guest_stack_release);
+}
+
+void prepare_env(CPUArchState *env, struct xloop_param *param)
+{
+    env->xregs[30] = *(uint64_t *)param->unwind_context->rsp;
+    if(env->xregs[31] == 0) {
+        /* virgin. get a stack for it. */
+        bool reused;
+        
+        mmap_lock();
+        abi_ulong stack = guest_stack_alloc(&reused);
+        env->stack_top = stack;
+        env->xregs[31] = stack + guest_stack_size + TARGET_PAGE_SIZE;
         env->stack_bottom = env->xregs[31];
+        guest_stack_log_usage(env, reused ? "reused" : "mapped");
+        mmap_unlock();
+        
+        /* give the stack back when this thread exits */
+        pthread_once(&guest_stack_key_once, guest_stack_key_init);
+        pthread_setspecific(guest_stack_key, env);
     }
 }
 
@@ -126,11 +227,9 @@ void
 CFIList_Truncate_To_By_Count(CPUArchState *env, int count)
 {
     if(count > 0) {
-        CFIEntry *pcfi = QTAILQ_FIRST(&env->CFIhead);
-        while(count-- > 0) {
-            QTAILQ_REMOVE(&env->CFIhead, pcfi, link);
-            pcfi = QTAILQ_FIRST(&env->CFIhead);
-        }
+        cfi_stack_drop(&env->CFIstack, count);
+        
+        CFIEntry *pcfi = CFIList_First(env);
         if(pcfi) {
             env->xregs[30] = *pcfi->p_arm64_pc;
             env->xregs[29] = *pcfi->p_arm64_fp;
@@ -146,15 +245,8 @@ CFIList_Truncate_To_By_Count(CPUArchState *env, int count)
 void
 CFIList_Truncate_To(CPUArchState *env, CFIEntry *entry)
 {
-    //
-    // set new CFI head.
-    // we could have just set new head, but there is no macro for this.
-    // crap.
-    CFIEntry *pcfi = QTAILQ_FIRST(&env->CFIhead);
-    while(pcfi != entry) {
-        QTAILQ_REMOVE(&env->CFIhead, pcfi, link);
-        pcfi = QTAILQ_FIRST(&env->CFIhead);
-    }
+    // drop everything above entry, which becomes the new head
+    cfi_stack_truncate_to(&env->CFIstack, entry);
     
     entry->p_arm64_pc = &env->xregs[30];
     entry->p_arm64_fp = &env->xregs[29];
@@ -168,7 +260,7 @@ CFIList_Insert_Head(CPUArchState *env, CFIEntry *entry,
                      uint64_t *last_sp)
 {
     /* setup last CFI, unlink registers from the env and link it to the saved ones */
-    CFIEntry *plast_cfi = QTAILQ_FIRST(&env->CFIhead);
+    CFIEntry *plast_cfi = CFIList_First(env);
     if(plast_cfi) {
         plast_cfi->p_arm64_pc = last_pc;
         plast_cfi->p_arm64_fp = last_fp;
@@ -178,7 +270,7 @@ CFIList_Insert_Head(CPUArchState *env, CFIEntry *entry,
     entry->p_arm64_fp = &env->xregs[29];
     entry->p_arm64_sp = &env->xregs[31];
     
-    QTAILQ_INSERT_HEAD(&env->CFIhead, (struct CFIEntry *)entry, link);
+    cfi_stack_push(&env->CFIstack, entry);
 }
 
 __attribute__((force_align_arg_pointer))
@@ -209,9 +301,19 @@ void cpu_xloop() {
     volatile fnEntryTranslation entry_translation = NULL;
     volatile fnExitTranslation exit_translation = NULL;
     
-    /* we make a copy of xloop_param in the stack */
-    volatile struct xloop_param xloop_param;
-    memcpy((void *)&xloop_param, &tls_xloop_param, sizeof(xloop_param));
+    /*
+     * Only the fields of tls_xloop_param we need after nested crossings
+     * (which overwrite it) are kept in the stack.
+     */
+    struct _Register_Context * volatile unwind_context = tls_xloop_param.unwind_context;
+    volatile int retn_stack_count = tls_xloop_param.retn_stack_count;
+    
+    /*
+     * cs->jmp_env belongs to the cpu_exec() of the crossing we are nested
+     * in, if any, and our own cpu_exec() is going to overwrite it. There
+     * is nothing to preserve in the outermost crossing of a thread.
+     */
+    volatile bool nested = env->CFIstack.depth != 0;
 
     /* to figure out where are we */
     
@@ -250,14 +352,15 @@ void cpu_xloop() {
                                     // of cpu_xloop, we just need a copy of them
                                     // to be referenced.
     
-    prepare_env(env, (struct xloop_param *)&xloop_param);
-    if(xloop_param.entry_translation == NULL ||
-       xloop_param.exit_translation == NULL) {
+    prepare_env(env, &tls_xloop_param);
+    if(tls_xloop_param.entry_translation == NULL ||
+       tls_xloop_param.exit_translation == NULL) {
         // determine it by pc
         abi_x2a_get_translation_function_pair_by_pc(env->pc, (fnEntryTranslation *)&entry_translation, (fnExitTranslation *)&exit_translation);
     } else {
-        entry_translation = xloop_param.entry_translation;
-        exit_translation = xloop_param.exit_translation;
+        // carried by the trampoline, see cpu_xloop_helper()
+        entry_translation = tls_xloop_param.entry_translation;
+        exit_translation = tls_xloop_param.exit_translation;
         // consume tls_xloop_param translation pair
         tls_xloop_param.entry_translation = NULL;
         tls_xloop_param.exit_translation = NULL;
@@ -269,18 +372,20 @@ void cpu_xloop() {
         abort();
     }
     
-    entry_translation(env, xloop_param.unwind_context);
+    entry_translation(env, unwind_context);
 
     
     /* setup CFI for this frame. */
     
-    cfi.x64_pc = *(uintptr_t *)xloop_param.unwind_context->rsp;
-    cfi.x64_sp = xloop_param.unwind_context->rsp;
-    cfi.x64_fp = xloop_param.unwind_context->rbp;
+    cfi.x64_pc = *(uintptr_t *)unwind_context->rsp;
+    cfi.x64_sp = unwind_context->rsp;
+    cfi.x64_fp = unwind_context->rbp;
     CFIList_Insert_Head(env, (CFIEntry *)&cfi, (uint64_t *)&saved_lr, &saved_fp, &saved_sp);
     
     sigjmp_buf saved_jmpbuf;
-    memcpy(saved_jmpbuf, cs->jmp_env, sizeof(saved_jmpbuf));
+    if(nested) {
+        memcpy(saved_jmpbuf, cs->jmp_env, sizeof(saved_jmpbuf));
+    }
     if(0 == setjmp((int *)cfi.jbuf)) {
         // do nothing.
     } else {
@@ -366,19 +471,21 @@ void cpu_xloop() {
             break;
         case EXCP_XLOOP_FINISH: {
             /* copy the retn stack count to the real xloop_param */
-            tls_xloop_param.retn_stack_count = xloop_param.retn_stack_count;
+            tls_xloop_param.retn_stack_count = retn_stack_count;
             
-            QTAILQ_REMOVE(&env->CFIhead, &cfi, link);
-            memcpy(cs->jmp_env, saved_jmpbuf, sizeof(saved_jmpbuf));
+            cfi_stack_pop_to(&env->CFIstack, (CFIEntry *)&cfi);
+            if(nested) {
+                memcpy(cs->jmp_env, saved_jmpbuf, sizeof(saved_jmpbuf));
+            }
             
-            CFIEntry *plast_cfi = QTAILQ_FIRST(&env->CFIhead);
+            CFIEntry *plast_cfi = CFIList_First(env);
             if(plast_cfi) {
                 plast_cfi->p_arm64_pc = &env->xregs[30];
                 plast_cfi->p_arm64_fp = &env->xregs[29];
                 plast_cfi->p_arm64_sp = &env->xregs[31];
             }
 
-            exit_translation(env, xloop_param.unwind_context);
+            exit_translation(env, unwind_context);
             env->xregs[30] = saved_lr;
             return;
         }
@@ -420,8 +527,6 @@ CPUArchState *create_arch_cpu()
     CPUArchState *env = cpu->env_ptr;
     cpu_reset(cpu);
     
-    QTAILQ_INIT(&env->CFIhead);
-    
     /* build Task State */
     TaskState *ts = &thread_ts; // g_new0(TaskState, 1);
     memset(ts, 0, sizeof(TaskState));
@@ -453,12 +558,29 @@ void
 image_preload(const struct mach_header *mh,
               intptr_t vmaddr_slide)
 {
+    image_map_add_header((const struct MACH_HEADER *)mh, vmaddr_slide);
     if(is_image_foreign((const struct MACH_HEADER *)mh)) {
         loader_exec((const struct MACH_HEADER *)mh);
         app_compatibility_level((const struct MACH_HEADER *)mh, vmaddr_slide);
     }
 }
 
+static
+void
+image_unload(const struct mach_header *mh,
+             intptr_t vmaddr_slide)
+{
+    ImageRange range;
+    if(!image_map_remove(mh, &range))
+        return;
+    if(range.loader)
+        forget_lazy_bind_image(range.loader);
+    if(range.tb_table)
+        tb_image_table_retire(range.tb_table);
+    if(range.foreign)
+        image_purge_caches((const struct MACH_HEADER *)mh, vmaddr_slide);
+}
+
 static __attribute__((constructor, visibility("default"), used))
 void
 firstborn_init()
@@ -471,8 +593,9 @@ void
 libiqemu_init(void)
 {
     const char *cpu_model;
-    const char *log_file = NULL;
-    const char *log_mask = NULL;
+    /* there is no command line, take -D and -d from the environment */
+    const char *log_file = getenv("QEMU_LOG_FILENAME");
+    const char *log_mask = getenv("QEMU_LOG");
     struct image_info info1, *info = &info1;
     TaskState *ts;
     CPUArchState *env;
@@ -546,6 +669,18 @@ libiqemu_init(void)
         do_strace = 1;
     }
 
+    if (getenv("QEMU_TIER_THRESHOLD")) {
+        tb_tier_threshold = strtoul(getenv("QEMU_TIER_THRESHOLD"), NULL, 0);
+    }
+
+    if (getenv("QEMU_TCG_WEIGHTED_REGALLOC")) {
+        tcg_weighted_regalloc = true;
+    }
+
+    if (qemu_loglevel_mask(LOG_STATS)) {
+        atexit(dump_exec_info);
+    }
+
     target_environ = envlist_to_environ(envlist, NULL);
     envlist_free(envlist);
 
@@ -644,6 +779,7 @@ libiqemu_init(void)
         abort();
     }
     _dyld_register_func_for_add_image(image_preload);
+    _dyld_register_func_for_remove_image(image_unload);
 
     dladdr(objc_getClass, &dlinfo);
     init_objc_system((struct MACH_HEADER *)dlinfo.dli_fbase);
@@ -29,6 +29,125 @@
 static pthread_mutex_t mmap_mutex = PTHREAD_MUTEX_INITIALIZER;
 static __thread int mmap_lock_count;
 
+/*
+ * The guest mappings made through target_mmap, as disjoint intervals
+ * ordered by address, with adjacent intervals of equal flags merged.
+ * Finding a gap or the flags of a range costs a tree search per mapping
+ * instead of a page_get_flags() per page. The page descriptors are still
+ * maintained by page_set_flags for translated code tracking.
+ * Protected by mmap_lock.
+ */
+typedef struct GuestVMA {
+    abi_ulong start;
+    abi_ulong end;
+    int flags;
+} GuestVMA;
+
+static GTree *guest_vmas;
+
+static gint guest_vma_compare(gconstpointer a, gconstpointer b, gpointer opaque)
+{
+    const GuestVMA *va = a, *vb = b;
+
+    if (va->end <= vb->start) {
+        return -1;
+    }
+    if (va->start >= vb->end) {
+        return 1;
+    }
+    return 0;
+}
+
+/* g_tree_search passes the node first and wants the target compared to it */
+static gint guest_vma_search(gconstpointer node, gconstpointer target)
+{
+    return guest_vma_compare(target, node, NULL);
+}
+
+static void __attribute__((constructor))
+guest_vmas_init(void)
+{
+    guest_vmas = g_tree_new_full(guest_vma_compare, NULL, g_free, NULL);
+}
+
+/* Any mapping overlapping [start, end), or NULL. */
+static GuestVMA *guest_vma_find(abi_ulong start, abi_ulong end)
+{
+    GuestVMA range = { .start = start, .end = end };
+
+    return g_tree_search(guest_vmas, guest_vma_search, &range);
+}
+
+static void guest_vma_insert(abi_ulong start, abi_ulong end, int flags)
+{
+    GuestVMA *vma = g_new(GuestVMA, 1);
+
+    vma->start = start;
+    vma->end = end;
+    vma->flags = flags;
+    g_tree_insert(guest_vmas, vma, vma);
+}
+
+static void guest_vma_set_flags(abi_ulong start, abi_ulong end, int flags)
+{
+    GuestVMA *vma;
+
+    /* cut [start, end) out of the existing mappings */
+    while ((vma = guest_vma_find(start, end)) != NULL) {
+        GuestVMA old = *vma;
+
+        g_tree_remove(guest_vmas, vma);
+        if (old.start < start) {
+            guest_vma_insert(old.start, start, old.flags);
+        }
+        if (old.end > end) {
+            guest_vma_insert(end, old.end, old.flags);
+        }
+    }
+    if (flags == 0) {
+        return;
+    }
+
+    if (start > 0 && (vma = guest_vma_find(start - 1, start)) != NULL &&
+        vma->flags == flags) {
+        start = vma->start;
+        g_tree_remove(guest_vmas, vma);
+    }
+    if (end + 1 > end && (vma = guest_vma_find(end, end + 1)) != NULL &&
+        vma->flags == flags) {
+        end = vma->end;
+        g_tree_remove(guest_vmas, vma);
+    }
+    guest_vma_insert(start, end, flags);
+}
+
+/* The union of the flags of the mappings overlapping [start, end). */
+static int guest_vma_get_flags(abi_ulong start, abi_ulong end)
+{
+    GuestVMA *vma = guest_vma_find(start, end);
+    int flags;
+
+    if (vma == NULL) {
+        return 0;
+    }
+    flags = vma->flags;
+    if (vma->start > start) {
+        flags |= guest_vma_get_flags(start, vma->start);
+    }
+    if (vma->end < end) {
+        flags |= guest_vma_get_flags(vma->end, end);
+    }
+    return flags;
+}
+
+/* page_set_flags, keeping guest_vmas in sync */
+static void mmap_set_flags(abi_ulong start, abi_ulong end, int flags)
+{
+    page_set_flags(start, end, flags);
+    guest_vma_set_flags(start & TARGET_PAGE_MASK, TARGET_PAGE_ALIGN(end),
+                        flags);
+}
+
 void mmap_lock(void)
 {
     if (mmap_lock_count++ == 0) {
@@ -137,7 +256,7 @@ int target_mprotect(abi_ulong start, abi_ulong len, int prot)
         if (ret != 0)
             goto error;
     }
-    page_set_flags(start, start + len, prot | PAGE_VALID);
+    mmap_set_flags(start, start + len, prot | PAGE_VALID);
     mmap_unlock();
     return 0;
 error:
@@ -213,8 +332,9 @@ unsigned long last_brk;
    to use them. */
 static abi_ulong mmap_find_vma(abi_ulong start, abi_ulong size)
 {
-    abi_ulong addr, addr1, addr_start;
-    int prot;
+    abi_ulong addr, addr_start;
+    GuestVMA *vma;
+    bool wrapped = false;
     unsigned long new_brk;
 
     new_brk = (unsigned long)sbrk(0);
@@ -224,7 +344,7 @@ static abi_ulong mmap_find_vma(abi_ulong start, abi_ulong size)
            FIXME: We really want to avoid the host allocating memory in
            the first place, and maybe leave some slack to avoid switching
            to mmap.  */
-        page_set_flags(last_brk & TARGET_PAGE_MASK,
+        mmap_set_flags(last_brk & TARGET_PAGE_MASK,
                        TARGET_PAGE_ALIGN(new_brk),
                        PAGE_RESERVED);
     }
@@ -237,16 +357,25 @@ static abi_ulong mmap_find_vma(abi_ulong start, abi_ulong size)
         addr = mmap_next_start;
     addr_start = addr;
     for(;;) {
-        prot = 0;
-        for(addr1 = addr; addr1 < (addr + size); addr1 += TARGET_PAGE_SIZE) {
-            prot |= page_get_flags(addr1);
+        if (wrapped && addr >= addr_start)
+            return (abi_ulong)-1;
+        if (addr + size < addr) {
+            /* wrap around once, then give up at addr_start */
+            if (wrapped)
+                return (abi_ulong)-1;
+            wrapped = true;
+            addr = qemu_host_page_size;
+            continue;
         }
-        if (prot == 0)
+        vma = guest_vma_find(addr, addr + size);
+        if (vma == NULL)
             break;
-        addr += qemu_host_page_size;
-        /* we found nothing */
-        if (addr == addr_start)
-            return (abi_ulong)-1;
+        /* skip the whole mapping in the way */
+        addr = HOST_PAGE_ALIGN(vma->end);
+        if (addr == 0) {
+            /* the mapping reaches the top: make the next check wrap */
+            addr = -qemu_host_page_size;
+        }
     }
     if (start == 0)
         mmap_next_start = addr + size;
@@ -322,9 +451,6 @@ abi_long target_mmap(abi_ulong start, abi_ulong len, int prot,
             host_start += offset - host_offset;
         start = h2g(host_start);
     } else {
-        int flg;
-        target_ulong addr;
-
         if (start & ~TARGET_PAGE_MASK) {
             errno = EINVAL;
             goto fail;
@@ -332,12 +458,9 @@ abi_long target_mmap(abi_ulong start, abi_ulong len, int prot,
         end = start + len;
         real_end = HOST_PAGE_ALIGN(end);
 
-        for(addr = real_start; addr < real_end; addr += TARGET_PAGE_SIZE) {
-            flg = page_get_flags(addr);
-            if (flg & PAGE_RESERVED) {
-                errno = ENXIO;
-                goto fail;
-            }
+        if (guest_vma_get_flags(real_start, real_end) & PAGE_RESERVED) {
+            errno = ENXIO;
+            goto fail;
         }
 
         /* worst case: we cannot map the file because the offset is not
@@ -409,7 +532,7 @@ abi_long target_mmap(abi_ulong start, abi_ulong len, int prot,
         }
     }
  the_end1:
-    page_set_flags(start, start + len, prot | PAGE_VALID);
+    mmap_set_flags(start, start + len, prot | PAGE_VALID);
  the_end:
 #ifdef DEBUG_MMAP
     printf("ret=0x" TARGET_FMT_lx "\n", start);
@@ -472,7 +595,7 @@ int target_munmap(abi_ulong start, abi_ulong len)
     }
 
     if (ret == 0)
-        page_set_flags(start, start + len, 0);
+        mmap_set_flags(start, start + len, 0);
     mmap_unlock();
     return ret;
 }
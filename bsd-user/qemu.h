@@ -229,6 +229,7 @@ void mmap_fork_end(int child);
 extern unsigned long x86_stack_size;
 
 CPUArchState *create_arch_cpu(void);
+void guest_stack_dump_info(void);
 
 void CFIList_Truncate_To_By_Count(CPUArchState *env, int count);
 void CFIList_Truncate_To(CPUArchState *env, CFIEntry *entry);
@@ -563,11 +564,17 @@ const char *solve_symbol_name(uintptr_t addr);
 uintptr_t solve_symbol_by_header(const struct MACH_HEADER *header, const char *name);
 
 #include "dbg.h"
+#include "imagemap.h"
+
+void image_map_add_header(const struct MACH_HEADER *header, intptr_t slide);
+void image_purge_caches(const struct MACH_HEADER *header, intptr_t slide);
 
 bool get_address_map(const void *address, target_ulong *base, target_ulong *size,
                      target_ulong *lbase, target_ulong *lsize);
 
 int loader_exec(const struct MACH_HEADER *header);
+bool mark_pending_lazy_bind_symbols(void);
+void forget_lazy_bind_image(void *imageLoader);
 
 //
 // appcomp.m
@@ -674,6 +681,7 @@ struct Block_byref {
 typedef void(*BlockCopyFunction)(void *, const void *);
 typedef void(*BlockDisposeFunction)(const void *);
 typedef void(*BlockInvokeFunction)(void *, ...);
+typedef void(*BlockFixupFunction)(struct Block_layout *, bool new_descriptor);
 typedef void(*BlockByrefKeepFunction)(struct Block_byref*, struct Block_byref*);
 typedef void(*BlockByrefDestroyFunction)(struct Block_byref *);
 struct Block_byref_2 {
@@ -724,8 +732,10 @@ block_get_aligned_size_for_stack_copy(struct Block_layout *block)
 }
 
 struct Block_layout *block_copy_to_stack_or_heap(uint8_t *u8dst, struct Block_layout *src);
-struct Block_layout *block_copy_to_heap_or_not(struct Block_layout *src);
+struct Block_layout *block_copy_to_heap_or_not(struct Block_layout *src,
+                                               BlockFixupFunction fixup);
 struct Block_layout *block_update_from_stack(uint8_t *stack);
+void block_copy_purge_range(uintptr_t start, uintptr_t end);
 static inline void
 block_update_from_copied(struct Block_layout *copied, struct Block_layout *orig)
 {
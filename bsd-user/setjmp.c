@@ -19,6 +19,14 @@
 
 #include "qemu.h"
 
+//#define DEBUG_SETJMP
+
+#ifdef DEBUG_SETJMP
+#define DPRINTF(fmt, ...) qemu_log(fmt, ## __VA_ARGS__)
+#else
+#define DPRINTF(fmt, ...) do { } while (0)
+#endif
+
 #define JMP_r19_20      0x00
 #define JMP_r21_22      0x10
 #define JMP_r23_24      0x20
@@ -48,17 +56,37 @@ int _arm_setjmp(uint64_t *buf, CPUArchState *env)
     return 0;
 }
 
+/*
+ * The guest signal mask is tracked in TaskState (see do_sigprocmask()),
+ * so saving it is a copy, and restoring it is skipped when it has not
+ * changed since the setjmp.
+ */
+static inline void arm_setjmp_save_mask(uint64_t *buf)
+{
+    do_sigprocmask(SIG_BLOCK, NULL, (sigset_t *)&buf[JMP_sig >> 3]);
+}
+
+static inline void arm_longjmp_restore_mask(uint64_t *buf)
+{
+    TaskState *ts = (TaskState *)thread_cpu->opaque;
+    const sigset_t *set = (const sigset_t *)&buf[JMP_sig >> 3];
+    
+    if (memcmp(set, &ts->signal_mask, sizeof(sigset_t)) != 0) {
+        do_sigprocmask(SIG_SETMASK, set, NULL);
+    }
+}
+
 int arm_sigsetjmp(uint64_t *buf, int sigmask, CPUArchState *env)
 {
     buf[JMP_sigflag >> 3] = sigmask;
     if(sigmask)
-        do_sigprocmask(SIG_BLOCK, NULL, (sigset_t *)&buf[JMP_sig >> 3]);
+        arm_setjmp_save_mask(buf);
     return _arm_setjmp(buf, env);
 }
 
 int arm_setjmp(uint64_t *buf, CPUArchState *env)
 {
-    do_sigprocmask(SIG_BLOCK, NULL, (sigset_t *)&buf[JMP_sig >> 3]);
+    arm_setjmp_save_mask(buf);
     return _arm_setjmp(buf, env);
 }
 
@@ -84,10 +112,10 @@ int _arm_longjmp(uint64_t *buf, int ret_val, CPUArchState *env)
 
 int arm_siglongjmp(uint64_t *buf, int ret_val, CPUArchState *env)
 {
-    uint64_t sigmask = buf[JMP_sigflag >> 2];
+    uint64_t sigmask = buf[JMP_sigflag >> 3];
     
     if(sigmask) {
-        do_sigprocmask(SIG_SETMASK, (const sigset_t *)&buf[JMP_sig >> 2], NULL);
+        arm_longjmp_restore_mask(buf);
     }
     
     return _arm_longjmp(buf, ret_val, env);
@@ -95,7 +123,7 @@ int arm_siglongjmp(uint64_t *buf, int ret_val, CPUArchState *env)
 
 int arm_longjmp(uint64_t *buf, int ret_val, CPUArchState *env)
 {
-    do_sigprocmask(SIG_SETMASK, (const sigset_t *)&buf[JMP_sig >> 2], NULL);
+    arm_longjmp_restore_mask(buf);
     return _arm_longjmp(buf, ret_val, env);
 }
 
@@ -104,7 +132,7 @@ int arm_longjmp(uint64_t *buf, int ret_val, CPUArchState *env)
 
 void call_arm_setjmp(CPUArchState *env)
 {
-    qemu_log("setjmp called.\n");
+    DPRINTF("setjmp called.\n");
     env->xregs[0] = arm_setjmp((uint64_t *)env->xregs[0], env);
     
     env->pc = env->xregs[30];
@@ -112,7 +140,7 @@ void call_arm_setjmp(CPUArchState *env)
 
 void call__arm_setjmp(CPUArchState *env)
 {
-    qemu_log("_setjmp called.\n");
+    DPRINTF("_setjmp called.\n");
     env->xregs[0] = _arm_setjmp((uint64_t *)env->xregs[0], env);
     
     env->pc = env->xregs[30];
@@ -120,7 +148,7 @@ void call__arm_setjmp(CPUArchState *env)
 
 void call_arm_sigsetjmp(CPUArchState *env)
 {
-    qemu_log("sigsetjmp called.\n");
+    DPRINTF("sigsetjmp called.\n");
     env->xregs[0] = arm_sigsetjmp((uint64_t *)env->xregs[0], (int)env->xregs[1], env);
     
     env->pc = env->xregs[30];
@@ -128,18 +156,18 @@ void call_arm_sigsetjmp(CPUArchState *env)
 
 void call_arm_longjmp(CPUArchState *env)
 {
-    qemu_log("longjmp called.\n");
+    DPRINTF("longjmp called.\n");
     env->xregs[0] = arm_longjmp((uint64_t *)env->xregs[0], (int)env->xregs[1], env);
 }
 
 void call__arm_longjmp(CPUArchState *env)
 {
-    qemu_log("_longjmp called.\n");
+    DPRINTF("_longjmp called.\n");
     env->xregs[0] = _arm_longjmp((uint64_t *)env->xregs[0], (int)env->xregs[1], env);
 }
 
 void call_arm_siglongjmp(CPUArchState *env)
 {
-    qemu_log("siglongjmp called.\n");
+    DPRINTF("siglongjmp called.\n");
     env->xregs[0] = arm_siglongjmp((uint64_t *)env->xregs[0], (int)env->xregs[1], env);
 }
@@ -2075,17 +2075,77 @@ float16 float16_round_to_int(float16 a, float_status *s)
     return float16_round_pack_canonical(pr, s);
 }
 
+/*
+ * Hardfloat rounding of a zero or normal input to an integral value.
+ * The result is exact or zero, so the only flag to compute is inexact.
+ * Returns false for the rounding modes the host cannot do directly.
+ */
+static inline bool hard_round_to_int(double x, int rmode, double *r,
+                                     float_status *s)
+{
+    if (QEMU_NO_HARDFLOAT) {
+        return false;
+    }
+    switch (rmode) {
+    case float_round_nearest_even:
+        *r = rint(x);
+        break;
+    case float_round_to_zero:
+        *r = trunc(x);
+        break;
+    case float_round_down:
+        *r = floor(x);
+        break;
+    case float_round_up:
+        *r = ceil(x);
+        break;
+    case float_round_ties_away:
+        *r = round(x);
+        break;
+    default:
+        return false;
+    }
+    if (*r != x) {
+        s->float_exception_flags |= float_flag_inexact;
+    }
+    return true;
+}
+
 float32 float32_round_to_int(float32 a, float_status *s)
 {
-    FloatParts pa = float32_unpack_canonical(a, s);
-    FloatParts pr = round_to_int(pa, s->float_rounding_mode, 0, s);
+    union_float32 ua;
+    double r;
+    FloatParts pa, pr;
+
+    ua.s = a;
+    float32_input_flush1(&ua.s, s);
+    if (float32_is_zero_or_normal(ua.s) &&
+        hard_round_to_int(ua.h, s->float_rounding_mode, &r, s)) {
+        ua.h = r;
+        return ua.s;
+    }
+
+    pa = float32_unpack_canonical(ua.s, s);
+    pr = round_to_int(pa, s->float_rounding_mode, 0, s);
     return float32_round_pack_canonical(pr, s);
 }
 
 float64 float64_round_to_int(float64 a, float_status *s)
 {
-    FloatParts pa = float64_unpack_canonical(a, s);
-    FloatParts pr = round_to_int(pa, s->float_rounding_mode, 0, s);
+    union_float64 ua;
+    double r;
+    FloatParts pa, pr;
+
+    ua.s = a;
+    float64_input_flush1(&ua.s, s);
+    if (float64_is_zero_or_normal(ua.s) &&
+        hard_round_to_int(ua.h, s->float_rounding_mode, &r, s)) {
+        ua.h = r;
+        return ua.s;
+    }
+
+    pa = float64_unpack_canonical(ua.s, s);
+    pr = round_to_int(pa, s->float_rounding_mode, 0, s);
     return float64_round_pack_canonical(pr, s);
 }
 
@@ -2146,6 +2206,38 @@ static int64_t round_to_int_and_pack(FloatParts in, int rmode, int scale,
     }
 }
 
+/*
+ * Hardfloat path for the float to integer conversions: no scaling, a
+ * rounding mode the host does directly, and a result in [min, limit).
+ * NaNs, infinities and out of range inputs all fail the range check and
+ * are left to the soft code, which raises invalid for them.
+ */
+static inline bool hard_float_to_int(double x, int rmode, int scale,
+                                     double min, double limit, double *r,
+                                     float_status *s)
+{
+    if (QEMU_NO_HARDFLOAT || scale != 0) {
+        return false;
+    }
+    switch (rmode) {
+    case float_round_nearest_even:
+        *r = rint(x);
+        break;
+    case float_round_to_zero:
+        *r = trunc(x);
+        break;
+    default:
+        return false;
+    }
+    if (!(*r >= min && *r < limit)) {
+        return false;
+    }
+    if (*r != x) {
+        s->float_exception_flags |= float_flag_inexact;
+    }
+    return true;
+}
+
 int16_t float16_to_int16_scalbn(float16 a, int rmode, int scale,
                                 float_status *s)
 {
@@ -2177,14 +2269,30 @@ int16_t float32_to_int16_scalbn(float32 a, int rmode, int scale,
 int32_t float32_to_int32_scalbn(float32 a, int rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float32_unpack_canonical(a, s),
+    union_float32 ua;
+    double r;
+
+    ua.s = a;
+    float32_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, INT32_MIN, 0x1p31, &r, s)) {
+        return r;
+    }
+    return round_to_int_and_pack(float32_unpack_canonical(ua.s, s),
                                  rmode, scale, INT32_MIN, INT32_MAX, s);
 }
 
 int64_t float32_to_int64_scalbn(float32 a, int rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float32_unpack_canonical(a, s),
+    union_float32 ua;
+    double r;
+
+    ua.s = a;
+    float32_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, INT64_MIN, 0x1p63, &r, s)) {
+        return r;
+    }
+    return round_to_int_and_pack(float32_unpack_canonical(ua.s, s),
                                  rmode, scale, INT64_MIN, INT64_MAX, s);
 }
 
@@ -2198,14 +2306,30 @@ int16_t float64_to_int16_scalbn(float64 a, int rmode, int scale,
 int32_t float64_to_int32_scalbn(float64 a, int rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float64_unpack_canonical(a, s),
+    union_float64 ua;
+    double r;
+
+    ua.s = a;
+    float64_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, INT32_MIN, 0x1p31, &r, s)) {
+        return r;
+    }
+    return round_to_int_and_pack(float64_unpack_canonical(ua.s, s),
                                  rmode, scale, INT32_MIN, INT32_MAX, s);
 }
 
 int64_t float64_to_int64_scalbn(float64 a, int rmode, int scale,
                                 float_status *s)
 {
-    return round_to_int_and_pack(float64_unpack_canonical(a, s),
+    union_float64 ua;
+    double r;
+
+    ua.s = a;
+    float64_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, INT64_MIN, 0x1p63, &r, s)) {
+        return r;
+    }
+    return round_to_int_and_pack(float64_unpack_canonical(ua.s, s),
                                  rmode, scale, INT64_MIN, INT64_MAX, s);
 }
 
@@ -2389,14 +2513,30 @@ uint16_t float32_to_uint16_scalbn(float32 a, int rmode, int scale,
 uint32_t float32_to_uint32_scalbn(float32 a, int rmode, int scale,
                                   float_status *s)
 {
-    return round_to_uint_and_pack(float32_unpack_canonical(a, s),
+    union_float32 ua;
+    double r;
+
+    ua.s = a;
+    float32_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, 0, 0x1p32, &r, s)) {
+        return r;
+    }
+    return round_to_uint_and_pack(float32_unpack_canonical(ua.s, s),
                                   rmode, scale, UINT32_MAX, s);
 }
 
 uint64_t float32_to_uint64_scalbn(float32 a, int rmode, int scale,
                                   float_status *s)
 {
-    return round_to_uint_and_pack(float32_unpack_canonical(a, s),
+    union_float32 ua;
+    double r;
+
+    ua.s = a;
+    float32_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, 0, 0x1p64, &r, s)) {
+        return r;
+    }
+    return round_to_uint_and_pack(float32_unpack_canonical(ua.s, s),
                                   rmode, scale, UINT64_MAX, s);
 }
 
@@ -2410,14 +2550,30 @@ uint16_t float64_to_uint16_scalbn(float64 a, int rmode, int scale,
 uint32_t float64_to_uint32_scalbn(float64 a, int rmode, int scale,
                                   float_status *s)
 {
-    return round_to_uint_and_pack(float64_unpack_canonical(a, s),
+    union_float64 ua;
+    double r;
+
+    ua.s = a;
+    float64_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, 0, 0x1p32, &r, s)) {
+        return r;
+    }
+    return round_to_uint_and_pack(float64_unpack_canonical(ua.s, s),
                                   rmode, scale, UINT32_MAX, s);
 }
 
 uint64_t float64_to_uint64_scalbn(float64 a, int rmode, int scale,
                                   float_status *s)
 {
-    return round_to_uint_and_pack(float64_unpack_canonical(a, s),
+    union_float64 ua;
+    double r;
+
+    ua.s = a;
+    float64_input_flush1(&ua.s, s);
+    if (hard_float_to_int(ua.h, rmode, scale, 0, 0x1p64, &r, s)) {
+        return r;
+    }
+    return round_to_uint_and_pack(float64_unpack_canonical(ua.s, s),
                                   rmode, scale, UINT64_MAX, s);
 }
 
@@ -2577,7 +2733,17 @@ float16 int16_to_float16(int16_t a, float_status *status)
 
 float32 int64_to_float32_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    FloatParts pa;
+
+    /* Never overflows; inexact is the only possible flag.  */
+    if (scale == 0 && can_use_fpu(status)) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = int_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -2608,7 +2774,17 @@ float32 int16_to_float32(int16_t a, float_status *status)
 
 float64 int64_to_float64_scalbn(int64_t a, int scale, float_status *status)
 {
-    FloatParts pa = int_to_float(a, scale, status);
+    FloatParts pa;
+
+    /* Never overflows; inexact is the only possible flag.  */
+    if (scale == 0 && can_use_fpu(status)) {
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = int_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -2702,7 +2878,17 @@ float16 uint16_to_float16(uint16_t a, float_status *status)
 
 float32 uint64_to_float32_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    FloatParts pa;
+
+    /* Never overflows; inexact is the only possible flag.  */
+    if (scale == 0 && can_use_fpu(status)) {
+        union_float32 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = uint_to_float(a, scale, status);
     return float32_round_pack_canonical(pa, status);
 }
 
@@ -2733,7 +2919,17 @@ float32 uint16_to_float32(uint16_t a, float_status *status)
 
 float64 uint64_to_float64_scalbn(uint64_t a, int scale, float_status *status)
 {
-    FloatParts pa = uint_to_float(a, scale, status);
+    FloatParts pa;
+
+    /* Never overflows; inexact is the only possible flag.  */
+    if (scale == 0 && can_use_fpu(status)) {
+        union_float64 ur;
+
+        ur.h = a;
+        return ur.s;
+    }
+
+    pa = uint_to_float(a, scale, status);
     return float64_round_pack_canonical(pa, status);
 }
 
@@ -2867,6 +3063,42 @@ MINMAX(16, max, false, false, false)
 MINMAX(16, maxnum, false, true, false)
 MINMAX(16, maxnummag, false, true, true)
 
+#undef MINMAX
+
+/*
+ * For two distinct zero-or-normal inputs the result is simply one of
+ * them and no flag is raised, so let the host compare them.  Equal
+ * values (including zeros of opposite sign), infinities, denormals
+ * that are not flushed and NaNs go the soft way.
+ */
+#define MINMAX(sz, name, ismin, isiee, ismag)                           \
+float ## sz float ## sz ## _ ## name(float ## sz a, float ## sz b,      \
+                                     float_status *s)                   \
+{                                                                       \
+    union_float ## sz ua, ub;                                           \
+    FloatParts pa, pb, pr;                                              \
+                                                                        \
+    ua.s = a;                                                           \
+    ub.s = b;                                                           \
+    if (!QEMU_NO_HARDFLOAT) {                                           \
+        float ## sz ## _input_flush2(&ua.s, &ub.s, s);                  \
+        if (f ## sz ## _is_zon2(ua, ub)) {                              \
+            if (ismag && fabs(ua.h) != fabs(ub.h)) {                    \
+                return (fabs(ua.h) < fabs(ub.h)) == ismin ? ua.s : ub.s; \
+            }                                                           \
+            if (ua.h != ub.h) {                                         \
+                return (ua.h < ub.h) == ismin ? ua.s : ub.s;            \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    pa = float ## sz ## _unpack_canonical(ua.s, s);                     \
+    pb = float ## sz ## _unpack_canonical(ub.s, s);                     \
+    pr = minmax_floats(pa, pb, ismin, isiee, ismag, s);                 \
+                                                                        \
+    return float ## sz ## _round_pack_canonical(pr, s);                 \
+}
+
 MINMAX(32, min, true, false, false)
 MINMAX(32, minnum, true, true, false)
 MINMAX(32, minnummag, true, true, true)
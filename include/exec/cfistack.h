@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020 上海芯竹科技有限公司
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXEC_CFISTACK_H
+#define EXEC_CFISTACK_H
+
+/*
+ * CFI entries of the x86_64 -> ARM crossings of a thread. The entries
+ * themselves live in the cpu_xloop() frames; the stack only keeps
+ * pointers to them, outermost first, and each entry records its own
+ * position so that truncating to it is O(1).
+ */
+typedef struct CFIEntry {
+    jmp_buf jbuf;
+    uint64_t x64_sp;
+    uint64_t x64_fp;
+    uint64_t x64_pc;
+    uint64_t *p_arm64_sp;
+    uint64_t *p_arm64_fp;
+    uint64_t *p_arm64_pc;
+
+    int depth;      /* position in the CFIStack */
+} CFIEntry;
+
+#define CFI_STACK_INIT_SIZE 64
+
+/* A zeroed CFIStack is empty; the array is allocated on the first push. */
+typedef struct CFIStack {
+    CFIEntry **entries;
+    int depth;
+    int capacity;
+} CFIStack;
+
+/* innermost entry, or NULL */
+static inline CFIEntry *cfi_stack_top(const CFIStack *s)
+{
+    return s->depth ? s->entries[s->depth - 1] : NULL;
+}
+
+/* @index-th entry counting from the innermost one, or NULL */
+static inline CFIEntry *cfi_stack_get(const CFIStack *s, int index)
+{
+    if (index < 0 || index >= s->depth) {
+        return NULL;
+    }
+    return s->entries[s->depth - 1 - index];
+}
+
+static inline void cfi_stack_push(CFIStack *s, CFIEntry *entry)
+{
+    if (unlikely(s->depth == s->capacity)) {
+        s->capacity = MAX(s->capacity * 2, CFI_STACK_INIT_SIZE);
+        s->entries = g_renew(CFIEntry *, s->entries, s->capacity);
+    }
+    entry->depth = s->depth;
+    s->entries[s->depth++] = entry;
+}
+
+/* Drop the @count innermost entries, or all of them if there are fewer. */
+static inline void cfi_stack_drop(CFIStack *s, int count)
+{
+    if (count > 0) {
+        s->depth -= MIN(count, s->depth);
+    }
+}
+
+/* Drop everything above @entry, which becomes the innermost entry. */
+static inline void cfi_stack_truncate_to(CFIStack *s, CFIEntry *entry)
+{
+    s->depth = entry->depth + 1;
+}
+
+/* Drop @entry and everything above it. */
+static inline void cfi_stack_pop_to(CFIStack *s, CFIEntry *entry)
+{
+    s->depth = entry->depth;
+}
+
+#endif /* EXEC_CFISTACK_H */
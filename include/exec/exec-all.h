@@ -75,6 +75,14 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                               uint32_t flags,
                               int cflags);
 
+/*
+ * Number of executions after which a CF_TIER0 TB is retranslated with the
+ * full optimization pipeline.  0 disables tiering: every TB is translated
+ * fully on first use.
+ */
+extern unsigned int tb_tier_threshold;
+void tb_tier_up(TranslationBlock *tb);
+
 void QEMU_NORETURN cpu_loop_exit(CPUState *cpu);
 void QEMU_NORETURN cpu_loop_exit_restore(CPUState *cpu, uintptr_t pc);
 void QEMU_NORETURN cpu_loop_exit_atomic(CPUState *cpu, uintptr_t pc);
@@ -465,6 +473,7 @@ struct TranslationBlock {
 #define CF_USE_ICOUNT  0x00020000
 #define CF_INVALID     0x00040000 /* TB is stale. Set with @jmp_lock held */
 #define CF_PARALLEL    0x00080000 /* Generate code for a parallel context */
+#define CF_TIER0       0x00100000 /* Quick translation, tiers up when hot */
 #define CF_CLUSTER_MASK 0xff000000 /* Top 8 bits are cluster ID */
 #define CF_CLUSTER_SHIFT 24
 /* cflags' mask for hashing/comparison */
@@ -474,10 +483,15 @@ struct TranslationBlock {
     /* Per-vCPU dynamic tracing state used to generate this TB */
     uint32_t trace_vcpu_dstate;
 
+    /* Executions left before a CF_TIER0 TB is retranslated */
+    uint32_t tier_count;
+
     struct tb_tc tc;
 
     /* original tb when cflags has CF_NOCACHE */
     struct TranslationBlock *orig_tb;
+    /* image table the TB is entered in, see tb_image_insert() */
+    struct TBImageTable *image_table;
     /* first and second physical page containing code. The lower bit
        of the pointer tells the index in page_next[].
        The list is protected by the TB's page('s) lock(s) */
@@ -546,6 +560,12 @@ void tb_flush(CPUState *cpu);
 void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr);
 TranslationBlock *tb_htable_lookup(CPUState *cpu, target_ulong pc
 );
+#if defined(CONFIG_USER_ONLY)
+typedef struct TBImageTable TBImageTable;
+TBImageTable *tb_image_table_new(target_ulong base, target_ulong size);
+void tb_image_table_retire(TBImageTable *table);
+TranslationBlock *tb_image_lookup(target_ulong pc);
+#endif
 void tb_set_jmp_target(TranslationBlock *tb, int n, uintptr_t addr);
 
 /* GETPC is the true target of the return instruction that we'll execute.  */
@@ -717,6 +737,7 @@ void cpu_xloop(void);
 
 void tcg_register_callback_as_type(target_ulong pc, const char *types);
 void tcg_register_callback_as_type_nolock(target_ulong pc, const char *types);
+void native_pc_forget(target_ulong pc);
 
 void call_arm_setjmp(CPUArchState *env);
 void call__arm_setjmp(CPUArchState *env);
@@ -33,7 +33,7 @@ tb_lookup__cpu_state(CPUState *cpu, target_ulong *pc)
     // Get the real pc if it is already in jit code
     if(iqemu_is_code_in_jit(*pc)) {
         // real one
-        if(*pc != QTAILQ_FIRST(&env->CFIhead)->x64_pc) {
+        if(*pc != CFIList_First(env)->x64_pc) {
             uint32_t mark = objc_get_real_pc((uintptr_t *)pc, NULL);
             if(mark == OBJC_ARM_MARK || mark == OBJC_ARM_BLOCK_MARK) {
                 // correct
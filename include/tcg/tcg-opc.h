@@ -210,6 +210,18 @@ DEF(qemu_ld_i64, DATA64_ARGS, TLADDR_ARGS, 1,
 DEF(qemu_st_i64, 0, TLADDR_ARGS + DATA64_ARGS, 1,
     TCG_OPF_CALL_CLOBBER | TCG_OPF_SIDE_EFFECTS | TCG_OPF_64BIT)
 
+/* Only on 64-bit user-mode hosts: no helper calls, single-reg args.  */
+#define IMPL_ATOMIC  TCG_OPF_SIDE_EFFECTS | IMPL(TCG_TARGET_HAS_atomic_rmw)
+
+DEF(atomic_fetch_add_i32, 1, 2, 1, IMPL_ATOMIC)
+DEF(atomic_xchg_i32, 1, 2, 1, IMPL_ATOMIC)
+DEF(atomic_cmpxchg_i32, 1, 3, 1, IMPL_ATOMIC)
+DEF(atomic_fetch_add_i64, 1, 2, 1, IMPL_ATOMIC | TCG_OPF_64BIT)
+DEF(atomic_xchg_i64, 1, 2, 1, IMPL_ATOMIC | TCG_OPF_64BIT)
+DEF(atomic_cmpxchg_i64, 1, 3, 1, IMPL_ATOMIC | TCG_OPF_64BIT)
+
+#undef IMPL_ATOMIC
+
 /* Host vector support.  */
 
 #define IMPLVEC  TCG_OPF_VECTOR | IMPL(TCG_TARGET_MAYBE_vec)
@@ -194,6 +194,9 @@ typedef uint64_t TCGRegSet;
 #else
 #define TCG_TARGET_MAYBE_vec            1
 #endif
+#ifndef TCG_TARGET_HAS_atomic_rmw
+#define TCG_TARGET_HAS_atomic_rmw       0
+#endif
 #ifndef TCG_TARGET_HAS_v64
 #define TCG_TARGET_HAS_v64              0
 #endif
@@ -578,6 +581,7 @@ typedef struct TCGProfile {
     int temp_count_max;
     int64_t temp_count;
     int64_t del_op_count;
+    int64_t kb_fold_count; /* ops simplified from known bits */
     int64_t code_in_len;
     int64_t code_out_len;
     int64_t search_out_len;
@@ -587,6 +591,8 @@ typedef struct TCGProfile {
     int64_t opt_time;
     int64_t restore_count;
     int64_t restore_time;
+    int64_t spill_count;    /* stores to free a register */
+    int64_t reload_count;   /* loads of a temp from its slot */
     int64_t table_op_count[NB_OPS];
 } TCGProfile;
 
@@ -649,6 +655,10 @@ struct TCGContext {
     
     GHashTable *trampolines;
     GHashTable *addr_to_symbolname;
+    GHashTable *tier1_pcs;      /* pcs whose TBs skip CF_TIER0 */
+
+    /* Weigh spills by the uses left in the TB, see tcg_count_uses */
+    bool weighted_regalloc;
 
     size_t tb_phys_invalidate_count;
 
@@ -686,6 +696,10 @@ struct TCGContext {
     TCGTemp temps[TCG_MAX_TEMPS]; /* globals first, temps after */
 
     QTAILQ_HEAD(, TCGOp) ops, free_ops;
+
+    /* Cold regions of the TB, see tcg_gen_cold_start */
+    QTAILQ_HEAD(, TCGOp) cold_ops;
+    TCGOp *cold_mark;
     QSIMPLEQ_HEAD(, TCGLabel) labels;
 
     /* Tells which temporary holds a given register.
@@ -698,6 +712,7 @@ struct TCGContext {
 
 extern TCGContext tcg_init_ctx;
 extern TCGContext *tcg_ctx;
+extern bool tcg_weighted_regalloc;
 extern TCGv_env cpu_env;
 
 static inline size_t temp_idx(TCGTemp *ts)
@@ -1045,6 +1060,8 @@ bool tcg_op_supported(TCGOpcode op);
 void tcg_gen_callN(void *func, TCGTemp *ret, int nargs, TCGTemp **args);
 
 TCGOp *tcg_emit_op(TCGOpcode opc);
+void tcg_gen_cold_start(void);
+void tcg_gen_cold_end(void);
 void tcg_op_remove(TCGContext *s, TCGOp *op);
 TCGOp *tcg_op_insert_before(TCGContext *s, TCGOp *op, TCGOpcode opc);
 TCGOp *tcg_op_insert_after(TCGContext *s, TCGOp *op, TCGOpcode opc);
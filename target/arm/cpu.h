@@ -215,17 +215,7 @@ typedef struct ARMPACKey {
 } ARMPACKey;
 #endif
 
-typedef struct CFIEntry {
-    jmp_buf jbuf;
-    uint64_t x64_sp;
-    uint64_t x64_fp;
-    uint64_t x64_pc;
-    uint64_t *p_arm64_sp;
-    uint64_t *p_arm64_fp;
-    uint64_t *p_arm64_pc;
-    
-    QTAILQ_ENTRY(CFIEntry) link;
-} CFIEntry;
+#include "exec/cfistack.h"
 
 typedef enum CODE_GEN_HINT {
     CODE_GEN_HINT_NONE = 0,
@@ -723,7 +713,8 @@ typedef struct CPUARMState {
     target_ulong stack_top;
     target_ulong stack_bottom;
     
-    QTAILQ_HEAD(, CFIEntry) CFIhead;
+    /* CFI entries of the x86_64 -> ARM crossings of this thread */
+    CFIStack CFIstack;
     
     struct {
         CODE_GEN_HINT code_gen_hint_type;
@@ -739,6 +730,18 @@ typedef struct CPUARMState {
     const char *lazy_symbol_name;
 } CPUARMState;
 
+/* innermost CFI entry, or NULL */
+static inline CFIEntry *CFIList_First(CPUARMState *env)
+{
+    return cfi_stack_top(&env->CFIstack);
+}
+
+/* @index-th CFI entry counting from the innermost one, or NULL */
+static inline CFIEntry *CFIList_Get(CPUARMState *env, int index)
+{
+    return cfi_stack_get(&env->CFIstack, index);
+}
+
 static inline
 void save_arm_parameter_regs(const CPUARMState *env, CPUARMParameterRegs *saved)
 {
@@ -29,6 +29,63 @@ union CRYPTO_STATE {
 #define CR_ST_WORD(state, i)   (state.words[i])
 #endif
 
+#if defined(CONFIG_CPUID_H) && defined(__x86_64__)
+#include "qemu/cpuid.h"
+#include <wmmintrin.h>
+
+/*
+ * The ARMv8 and AES-NI round primitives use the same state layout, and
+ * vector registers are stored little-endian on an x86 host, so the
+ * 16 bytes can be handed to the host instructions as they are.
+ * AES-NI has no plain MixColumns; AESENC after AESDECLAST with zero
+ * keys cancels out everything but MixColumns.
+ */
+static bool have_aesni;
+
+static void __attribute__((constructor)) init_crypto_accel(void)
+{
+    unsigned a, b, c, d;
+
+    if (__get_cpuid_max(0, NULL) >= 1) {
+        __cpuid(1, a, b, c, d);
+        have_aesni = (c & bit_AES) != 0;
+    }
+}
+
+static void __attribute__((target("aes")))
+aesni_aese(uint64_t *rd, uint64_t *rm, uint32_t decrypt)
+{
+    __m128i st = _mm_xor_si128(_mm_loadu_si128((__m128i *)rd),
+                               _mm_loadu_si128((__m128i *)rm));
+    __m128i zero = _mm_setzero_si128();
+
+    if (decrypt) {
+        st = _mm_aesdeclast_si128(st, zero);
+    } else {
+        st = _mm_aesenclast_si128(st, zero);
+    }
+    _mm_storeu_si128((__m128i *)rd, st);
+}
+
+static void __attribute__((target("aes")))
+aesni_aesmc(uint64_t *rd, uint64_t *rm, uint32_t decrypt)
+{
+    __m128i st = _mm_loadu_si128((__m128i *)rm);
+    __m128i zero = _mm_setzero_si128();
+
+    if (decrypt) {
+        st = _mm_aesimc_si128(st);
+    } else {
+        st = _mm_aesenc_si128(_mm_aesdeclast_si128(st, zero), zero);
+    }
+    _mm_storeu_si128((__m128i *)rd, st);
+}
+#else
+#define have_aesni  false
+#define aesni_aese(rd, rm, decrypt)   g_assert_not_reached()
+#define aesni_aesmc(rd, rm, decrypt)  g_assert_not_reached()
+#endif
+
 void HELPER(crypto_aese)(void *vd, void *vm, uint32_t decrypt)
 {
     static uint8_t const * const sbox[2] = { AES_sbox, AES_isbox };
@@ -41,6 +98,11 @@ void HELPER(crypto_aese)(void *vd, void *vm, uint32_t decrypt)
 
     assert(decrypt < 2);
 
+    if (have_aesni) {
+        aesni_aese(rd, rm, decrypt);
+        return;
+    }
+
     /* xor state vector with round key */
     rk.l[0] ^= st.l[0];
     rk.l[1] ^= st.l[1];
@@ -197,6 +259,11 @@ void HELPER(crypto_aesmc)(void *vd, void *vm, uint32_t decrypt)
 
     assert(decrypt < 2);
 
+    if (have_aesni) {
+        aesni_aesmc(rd, rm, decrypt);
+        return;
+    }
+
     for (i = 0; i < 16; i += 4) {
         CR_ST_WORD(st, i >> 2) =
             mc[decrypt][CR_ST_BYTE(st, i)] ^
@@ -269,6 +269,115 @@ static void a64_free_cc(DisasCompare64 *c64)
     tcg_temp_free_i64(c64->value);
 }
 
+static void a64_record_cc(DisasContext *s, A64CCSrcKind kind, bool sf,
+                          bool rn_sp, int rn, int rm, uint64_t imm)
+{
+    s->cc_src_next = (A64CCSrc) {
+        .kind = kind, .sf = sf, .rn_sp = rn_sp,
+        .rn = rn, .rm = rm, .imm = imm,
+    };
+}
+
+/*
+ * Note that RD holds VAL after this insn, so that an immediately following
+ * ADD/MOVK/LDR based on it (the ADRP+ADD, ADRP+LDR and MOVZ+MOVK idioms)
+ * can fold the value instead of reading the register back.  The earlier
+ * write to RD is then dead if the later insn overwrites it, and is removed
+ * by the TCG liveness pass; otherwise it is kept.
+ */
+static void a64_record_const(DisasContext *s, int rd, uint64_t val)
+{
+    if (rd != 31) {
+        s->const_reg_next = rd;
+        s->const_val_next = val;
+    }
+}
+
+static bool a64_known_const(DisasContext *s, int rn, uint64_t *val)
+{
+    if (rn != 31 && s->const_reg == rn) {
+        *val = s->const_val;
+        return true;
+    }
+    return false;
+}
+
+/*
+ * If the previous insn was a CMP or TST recorded by a64_record_cc, set
+ * *a, *b and *cond such that "*a cond *b" is the same test as condition
+ * code CC against the flags that insn produced.  The NZCV globals are still
+ * written by the CMP/TST itself, so this only replaces the reconstruction
+ * of the condition on the consumer side with a single host compare.
+ * The returned operands are auto-freed temporaries.
+ */
+static bool a64_fuse_cc(DisasContext *s, int cc, TCGCond *cond,
+                        TCGv_i64 *a, TCGv_i64 *b)
+{
+    /* TCG_COND_NEVER marks conditions that cannot be derived this way. */
+    static const TCGCond sub_cond[16] = {
+        [0x0] = TCG_COND_EQ,  [0x1] = TCG_COND_NE,
+        [0x2] = TCG_COND_GEU, [0x3] = TCG_COND_LTU,
+        [0x8] = TCG_COND_GTU, [0x9] = TCG_COND_LEU,
+        [0xa] = TCG_COND_GE,  [0xb] = TCG_COND_LT,
+        [0xc] = TCG_COND_GT,  [0xd] = TCG_COND_LE,
+    };
+    /* C and V are cleared by a logical op, so compare the result with 0. */
+    static const TCGCond logic_cond[16] = {
+        [0x0] = TCG_COND_EQ,  [0x1] = TCG_COND_NE,
+        [0x4] = TCG_COND_LT,  [0x5] = TCG_COND_GE,
+        [0xa] = TCG_COND_GE,  [0xb] = TCG_COND_LT,
+        [0xc] = TCG_COND_GT,  [0xd] = TCG_COND_LE,
+    };
+    A64CCSrc *src = &s->cc_src;
+    TCGCond c;
+
+    switch (src->kind) {
+    case A64_CC_SRC_SUB:
+        c = sub_cond[cc & 0xf];
+        break;
+    case A64_CC_SRC_LOGIC:
+        c = logic_cond[cc & 0xf];
+        break;
+    default:
+        return false;
+    }
+    if (c == TCG_COND_NEVER) {
+        return false;
+    }
+
+    *a = new_tmp_a64(s);
+    *b = new_tmp_a64(s);
+    if (src->rn == 31 && !src->rn_sp) {
+        tcg_gen_movi_i64(*a, 0);
+    } else {
+        tcg_gen_mov_i64(*a, cpu_X[src->rn]);
+    }
+    if (src->rm < 0) {
+        tcg_gen_movi_i64(*b, src->imm);
+    } else if (src->rm == 31) {
+        tcg_gen_movi_i64(*b, 0);
+    } else {
+        tcg_gen_mov_i64(*b, cpu_X[src->rm]);
+    }
+
+    if (src->kind == A64_CC_SRC_LOGIC) {
+        tcg_gen_and_i64(*a, *a, *b);
+        tcg_gen_movi_i64(*b, 0);
+    }
+    if (!src->sf) {
+        if (is_unsigned_cond(c) || c == TCG_COND_EQ || c == TCG_COND_NE) {
+            tcg_gen_ext32u_i64(*a, *a);
+            tcg_gen_ext32u_i64(*b, *b);
+        } else {
+            tcg_gen_ext32s_i64(*a, *a);
+            tcg_gen_ext32s_i64(*b, *b);
+        }
+    }
+
+    *cond = c;
+    return true;
+}
+
 static void gen_exception_internal(int excp)
 {
     TCGv_i32 tcg_excp = tcg_const_i32(excp);
@@ -363,6 +472,37 @@ static inline void gen_goto_tb(DisasContext *s, int n, uint64_t dest)
     }
 }
 
+/*
+ * Continue translating at the target of an unconditional direct branch
+ * instead of ending the TB there.  This keeps guest registers in host
+ * registers across the branch rather than syncing them to env and
+ * reloading them in the next TB.
+ *
+ * Only forward branches within the page of the TB are followed, so that
+ * [tb->pc, tb->pc + tb->size) still covers every translated insn and page
+ * invalidation keeps working unchanged.
+ */
+static bool follow_direct_branch(DisasContext *s, uint64_t dest)
+{
+    int remain;
+
+    if (!use_goto_tb(s, 0, dest) || (tb_cflags(s->base.tb) & CF_NOCACHE)) {
+        return false;
+    }
+    if (dest <= s->pc_curr ||
+        (dest & TARGET_PAGE_MASK) != (s->base.pc_first & TARGET_PAGE_MASK)) {
+        return false;
+    }
+    if (s->base.num_insns >= s->base.max_insns) {
+        return false;
+    }
+
+    /* Re-bound the insn count to what is left on the page after dest.  */
+    remain = -(dest | TARGET_PAGE_MASK) / 4;
+    s->base.max_insns = MIN(s->base.max_insns, s->base.num_insns + remain);
+    return true;
+}
+
 void unallocated_encoding(DisasContext *s)
 {
     /* Unallocated and reserved encodings are uncategorized */
@@ -985,6 +1125,75 @@ static void do_fp_ld(DisasContext *s, int destidx, TCGv_i64 tcg_addr, int size)
     clear_vec_high(s, true, destidx);
 }
 
+/*
+ * Load/store a pair of 32-bit registers (LDP/STP Wt or St, LDPSW).
+ * The two words are one contiguous doubleword, so a single 64-bit
+ * memory access replaces the two word accesses; the halves are split
+ * or merged in registers.  The access faults as a whole before either
+ * destination is written, as required for the pair.
+ */
+static void do_pair32_ld(DisasContext *s, bool is_vector, bool is_signed,
+                         int rt, int rt2, TCGv_i64 tcg_addr)
+{
+    bool be = s->be_data == MO_BE;
+    TCGv_i64 tmp = tcg_temp_new_i64();
+    TCGv_i64 lo = tcg_temp_new_i64();
+    TCGv_i64 hi = tcg_temp_new_i64();
+
+    tcg_gen_qemu_ld_i64(tmp, tcg_addr, get_mem_index(s), s->be_data | MO_Q);
+    if (is_signed) {
+        tcg_gen_ext32s_i64(lo, tmp);
+        tcg_gen_sari_i64(hi, tmp, 32);
+    } else {
+        tcg_gen_ext32u_i64(lo, tmp);
+        tcg_gen_shri_i64(hi, tmp, 32);
+    }
+
+    /* The word at the lower address is Rt.  */
+    if (is_vector) {
+        write_fp_dreg(s, rt, be ? hi : lo);
+        write_fp_dreg(s, rt2, be ? lo : hi);
+    } else {
+        tcg_gen_mov_i64(cpu_reg(s, rt), be ? hi : lo);
+        tcg_gen_mov_i64(cpu_reg(s, rt2), be ? lo : hi);
+    }
+
+    tcg_temp_free_i64(tmp);
+    tcg_temp_free_i64(lo);
+    tcg_temp_free_i64(hi);
+}
+
+static void do_pair32_st(DisasContext *s, bool is_vector,
+                         int rt, int rt2, TCGv_i64 tcg_addr)
+{
+    bool be = s->be_data == MO_BE;
+    TCGv_i64 tmp = tcg_temp_new_i64();
+    TCGv_i64 t1, t2;
+
+    if (is_vector) {
+        t1 = tcg_temp_new_i64();
+        t2 = tcg_temp_new_i64();
+        tcg_gen_ld32u_i64(t1, cpu_env, fp_reg_offset(s, rt, MO_32));
+        tcg_gen_ld32u_i64(t2, cpu_env, fp_reg_offset(s, rt2, MO_32));
+    } else {
+        t1 = cpu_reg(s, rt);
+        t2 = cpu_reg(s, rt2);
+    }
+
+    if (be) {
+        tcg_gen_concat32_i64(tmp, t2, t1);
+    } else {
+        tcg_gen_concat32_i64(tmp, t1, t2);
+    }
+    tcg_gen_qemu_st_i64(tmp, tcg_addr, get_mem_index(s), s->be_data | MO_Q);
+
+    if (is_vector) {
+        tcg_temp_free_i64(t1);
+        tcg_temp_free_i64(t2);
+    }
+    tcg_temp_free_i64(tmp);
+}
+
 /*
  * Vector load/store helpers.
  *
@@ -1267,6 +1476,10 @@ static void disas_uncond_b_imm(DisasContext *s, uint32_t insn)
 
     /* B Branch / BL Branch with link */
     reset_btype(s);
+    if (follow_direct_branch(s, addr)) {
+        s->base.pc_next = addr;
+        return;
+    }
     gen_goto_tb(s, 0, addr);
 }
 
@@ -1353,7 +1566,14 @@ static void disas_cond_b_imm(DisasContext *s, uint32_t insn)
     if (cond < 0x0e) {
         /* genuinely conditional branches */
         TCGLabel *label_match = gen_new_label();
-        arm_gen_test_cc(cond, label_match);
+        TCGv_i64 tcg_a, tcg_b;
+        TCGCond tcg_cond;
+
+        if (a64_fuse_cc(s, cond, &tcg_cond, &tcg_a, &tcg_b)) {
+            tcg_gen_brcond_i64(tcg_cond, tcg_a, tcg_b, label_match);
+        } else {
+            arm_gen_test_cc(cond, label_match);
+        }
         gen_goto_tb(s, 0, s->base.pc_next);
         gen_set_label(label_match);
         gen_goto_tb(s, 1, addr);
@@ -2354,10 +2574,14 @@ static void gen_store_exclusive(DisasContext *s, int rd, int rt, int rt2,
     }
     tcg_gen_mov_i64(cpu_reg(s, rd), tmp);
     tcg_temp_free_i64(tmp);
-    tcg_gen_br(done_label);
 
+    /* a mismatched address is rare, keep it out of the way */
+    tcg_gen_cold_start();
     gen_set_label(fail_label);
     tcg_gen_movi_i64(cpu_reg(s, rd), 1);
+    tcg_gen_br(done_label);
+    tcg_gen_cold_end();
+
     gen_set_label(done_label);
     tcg_gen_movi_i64(cpu_exclusive_addr, -1);
 }
@@ -2785,7 +3009,13 @@ static void disas_ldst_pair(DisasContext *s, uint32_t insn)
     }
     clean_addr = clean_data_tbi(s, dirty_addr);
 
-    if (is_vector) {
+    if (size == 2) {
+        if (is_load) {
+            do_pair32_ld(s, is_vector, is_signed, rt, rt2, clean_addr);
+        } else {
+            do_pair32_st(s, is_vector, rt, rt2, clean_addr);
+        }
+    } else if (is_vector) {
         if (is_load) {
             do_fp_ld(s, rt, clean_addr, size);
         } else {
@@ -3076,6 +3306,7 @@ static void disas_ldst_reg_unsigned_imm(DisasContext *s, uint32_t insn,
     int rn = extract32(insn, 5, 5);
     unsigned int imm12 = extract32(insn, 10, 12);
     unsigned int offset;
+    uint64_t base;
 
     TCGv_i64 clean_addr, dirty_addr;
 
@@ -3110,9 +3341,15 @@ static void disas_ldst_reg_unsigned_imm(DisasContext *s, uint32_t insn,
     if (rn == 31) {
         gen_check_sp_alignment(s);
     }
-    dirty_addr = read_cpu_reg_sp(s, rn, 1);
     offset = imm12 << size;
-    tcg_gen_addi_i64(dirty_addr, dirty_addr, offset);
+    if (a64_known_const(s, rn, &base)) {
+        /* ADRP+LDR/STR: access the absolute address directly.  */
+        dirty_addr = new_tmp_a64(s);
+        tcg_gen_movi_i64(dirty_addr, base + offset);
+    } else {
+        dirty_addr = read_cpu_reg_sp(s, rn, 1);
+        tcg_gen_addi_i64(dirty_addr, dirty_addr, offset);
+    }
     clean_addr = clean_data_tbi(s, dirty_addr);
 
     if (is_vector) {
@@ -3768,6 +4005,7 @@ static void disas_pc_rel_adr(DisasContext *s, uint32_t insn)
     }
 
     tcg_gen_movi_i64(cpu_reg(s, rd), base + offset);
+    a64_record_const(s, rd, base + offset);
 }
 
 /*
@@ -3796,6 +4034,7 @@ static void disas_add_sub_imm(DisasContext *s, uint32_t insn)
     TCGv_i64 tcg_rn = cpu_reg_sp(s, rn);
     TCGv_i64 tcg_rd = setflags ? cpu_reg(s, rd) : cpu_reg_sp(s, rd);
     TCGv_i64 tcg_result;
+    uint64_t base;
 
     switch (shift) {
     case 0x0:
@@ -3808,6 +4047,17 @@ static void disas_add_sub_imm(DisasContext *s, uint32_t insn)
         return;
     }
 
+    if (!setflags && a64_known_const(s, rn, &base)) {
+        /* ADRP+ADD, MOVZ+ADD: the result is a constant too.  */
+        base = sub_op ? base - imm : base + imm;
+        if (!is_64bit) {
+            base &= 0xffffffffu;
+        }
+        tcg_gen_movi_i64(tcg_rd, base);
+        a64_record_const(s, rd, base);
+        return;
+    }
+
     tcg_result = tcg_temp_new_i64();
     if (!setflags) {
         if (sub_op) {
@@ -3819,6 +4069,10 @@ static void disas_add_sub_imm(DisasContext *s, uint32_t insn)
         TCGv_i64 tcg_imm = tcg_const_i64(imm);
         if (sub_op) {
             gen_sub_CC(is_64bit, tcg_result, tcg_rn, tcg_imm);
+            if (rd == 31) {
+                /* CMP (immediate) */
+                a64_record_cc(s, A64_CC_SRC_SUB, is_64bit, true, rn, -1, imm);
+            }
         } else {
             gen_add_CC(is_64bit, tcg_result, tcg_rn, tcg_imm);
         }
@@ -3990,6 +4244,10 @@ static void disas_logic_imm(DisasContext *s, uint32_t insn)
 
     if (opc == 3) { /* ANDS */
         gen_logic_CC(sf, tcg_rd);
+        if (rd == 31) {
+            /* TST (immediate) */
+            a64_record_cc(s, A64_CC_SRC_LOGIC, sf, false, rn, -1, wmask);
+        }
     }
 }
 
@@ -4014,6 +4272,7 @@ static void disas_movw_imm(DisasContext *s, uint32_t insn)
     int pos = extract32(insn, 21, 2) << 4;
     TCGv_i64 tcg_rd = cpu_reg(s, rd);
     TCGv_i64 tcg_imm;
+    uint64_t val;
 
     if (!sf && (pos >= 32)) {
         unallocated_encoding(s);
@@ -4031,8 +4290,19 @@ static void disas_movw_imm(DisasContext *s, uint32_t insn)
             imm &= 0xffffffffu;
         }
         tcg_gen_movi_i64(tcg_rd, imm);
+        a64_record_const(s, rd, imm);
         break;
     case 3: /* MOVK */
+        if (a64_known_const(s, rd, &val)) {
+            /* MOVZ+MOVK chain: keep materializing a single constant.  */
+            val = deposit64(val, pos, 16, imm);
+            if (!sf) {
+                val &= 0xffffffffu;
+            }
+            tcg_gen_movi_i64(tcg_rd, val);
+            a64_record_const(s, rd, val);
+            break;
+        }
         tcg_imm = tcg_const_i64(imm);
         tcg_gen_deposit_i64(tcg_rd, tcg_rd, tcg_imm, pos, 16);
         tcg_temp_free_i64(tcg_imm);
@@ -4367,6 +4637,10 @@ static void disas_logic_reg(DisasContext *s, uint32_t insn)
 
     if (opc == 3) {
         gen_logic_CC(sf, tcg_rd);
+        if (rd == 31 && !invert && shift_amount == 0) {
+            /* TST (unshifted register) */
+            a64_record_cc(s, A64_CC_SRC_LOGIC, sf, false, rn, rm, 0);
+        }
     }
 }
 
@@ -4494,6 +4768,10 @@ static void disas_add_sub_reg(DisasContext *s, uint32_t insn)
     } else {
         if (sub_op) {
             gen_sub_CC(sf, tcg_result, tcg_rn, tcg_rm);
+            if (rd == 31 && imm6 == 0) {
+                /* CMP (unshifted register) */
+                a64_record_cc(s, A64_CC_SRC_SUB, sf, false, rn, rm, 0);
+            }
         } else {
             gen_add_CC(sf, tcg_result, tcg_rn, tcg_rm);
         }
@@ -4836,6 +5114,7 @@ static void disas_cond_select(DisasContext *s, uint32_t insn)
     unsigned int sf, else_inv, rm, cond, else_inc, rn, rd;
     TCGv_i64 tcg_rd, zero;
     DisasCompare64 c;
+    bool fused;
 
     if (extract32(insn, 29, 1) || extract32(insn, 11, 1)) {
         /* S == 1 or op2<1> == 1 */
@@ -4852,8 +5131,11 @@ static void disas_cond_select(DisasContext *s, uint32_t insn)
 
     tcg_rd = cpu_reg(s, rd);
 
-    a64_test_cc(&c, cond);
-    zero = tcg_const_i64(0);
+    fused = a64_fuse_cc(s, cond, &c.cond, &c.value, &zero);
+    if (!fused) {
+        a64_test_cc(&c, cond);
+        zero = tcg_const_i64(0);
+    }
 
     if (rn == 31 && rm == 31 && (else_inc ^ else_inv)) {
         /* CSET & CSETM.  */
@@ -4874,8 +5156,10 @@ static void disas_cond_select(DisasContext *s, uint32_t insn)
         tcg_gen_movcond_i64(c.cond, tcg_rd, c.value, zero, t_true, t_false);
     }
 
-    tcg_temp_free_i64(zero);
-    a64_free_cc(&c);
+    if (!fused) {
+        tcg_temp_free_i64(zero);
+        a64_free_cc(&c);
+    }
 
     if (!sf) {
         tcg_gen_ext32u_i64(tcg_rd, tcg_rd);
@@ -7039,8 +7323,6 @@ static void disas_simd_tb(DisasContext *s, uint32_t insn)
     int rd = extract32(insn, 0, 5);
     int is_tblx = extract32(insn, 12, 1);
     int len = extract32(insn, 13, 2);
-    TCGv_i64 tcg_resl, tcg_resh, tcg_idx;
-    TCGv_i32 tcg_regno, tcg_numregs;
 
     if (op2 != 0) {
         unallocated_encoding(s);
@@ -7053,44 +7335,14 @@ static void disas_simd_tb(DisasContext *s, uint32_t insn)
 
     /* This does a table lookup: for every byte element in the input
      * we index into a table formed from up to four vector registers,
-     * and then the output is the result of the lookups. Our helper
-     * function does the lookup operation for a single 64 bit part of
-     * the input.
+     * and then the output is the result of the lookups.  The helper
+     * works on the whole vector at once, so pass it env to reach the
+     * (possibly wrapping) table registers.
      */
-    tcg_resl = tcg_temp_new_i64();
-    tcg_resh = tcg_temp_new_i64();
-
-    if (is_tblx) {
-        read_vec_element(s, tcg_resl, rd, 0, MO_64);
-    } else {
-        tcg_gen_movi_i64(tcg_resl, 0);
-    }
-    if (is_tblx && is_q) {
-        read_vec_element(s, tcg_resh, rd, 1, MO_64);
-    } else {
-        tcg_gen_movi_i64(tcg_resh, 0);
-    }
-
-    tcg_idx = tcg_temp_new_i64();
-    tcg_regno = tcg_const_i32(rn);
-    tcg_numregs = tcg_const_i32(len + 1);
-    read_vec_element(s, tcg_idx, rm, 0, MO_64);
-    gen_helper_simd_tbl(tcg_resl, cpu_env, tcg_resl, tcg_idx,
-                        tcg_regno, tcg_numregs);
-    if (is_q) {
-        read_vec_element(s, tcg_idx, rm, 1, MO_64);
-        gen_helper_simd_tbl(tcg_resh, cpu_env, tcg_resh, tcg_idx,
-                            tcg_regno, tcg_numregs);
-    }
-    tcg_temp_free_i64(tcg_idx);
-    tcg_temp_free_i32(tcg_regno);
-    tcg_temp_free_i32(tcg_numregs);
-
-    write_vec_element(s, tcg_resl, rd, 0, MO_64);
-    tcg_temp_free_i64(tcg_resl);
-    write_vec_element(s, tcg_resh, rd, 1, MO_64);
-    tcg_temp_free_i64(tcg_resh);
-    clear_vec_high(s, true, rd);
+    tcg_gen_gvec_2_ptr(vec_full_reg_offset(s, rd), vec_full_reg_offset(s, rm),
+                       cpu_env, is_q ? 16 : 8, vec_full_reg_size(s),
+                       rn | (len << 5) | (is_tblx << 7),
+                       gen_helper_simd_tbl);
 }
 
 /* ZIP/UZP/TRN
@@ -11139,6 +11391,24 @@ static void disas_simd_3same_float(DisasContext *s, uint32_t insn)
         handle_simd_3same_pair(s, is_q, 0, fpopcode, size ? MO_64 : MO_32,
                                rn, rm, rd);
         return;
+    case 0x1a: /* FADD */
+    case 0x3a: /* FSUB */
+    case 0x5b: /* FMUL */
+    case 0x5f: /* FDIV */
+        /* Whole-vector helpers, which can use the host FPU on all lanes.  */
+        if (fp_access_check(s)) {
+            static gen_helper_gvec_3_ptr * const fns[4][2] = {
+                { gen_helper_gvec_fadd_s, gen_helper_gvec_fadd_d },
+                { gen_helper_gvec_fsub_s, gen_helper_gvec_fsub_d },
+                { gen_helper_gvec_fmul_s, gen_helper_gvec_fmul_d },
+                { gen_helper_gvec_fdiv_s, gen_helper_gvec_fdiv_d },
+            };
+            int op = fpopcode == 0x1a ? 0 : fpopcode == 0x3a ? 1
+                   : fpopcode == 0x5b ? 2 : 3;
+
+            gen_gvec_op3_fpst(s, is_q, rd, rn, rm, false, 0, fns[op][size]);
+        }
+        return;
     case 0x1b: /* FMULX */
     case 0x1f: /* FRECPS */
     case 0x3f: /* FRSQRTS */
@@ -11147,15 +11417,11 @@ static void disas_simd_3same_float(DisasContext *s, uint32_t insn)
     case 0x19: /* FMLA */
     case 0x39: /* FMLS */
     case 0x18: /* FMAXNM */
-    case 0x1a: /* FADD */
     case 0x1c: /* FCMEQ */
     case 0x1e: /* FMAX */
     case 0x38: /* FMINNM */
-    case 0x3a: /* FSUB */
     case 0x3e: /* FMIN */
-    case 0x5b: /* FMUL */
     case 0x5c: /* FCMGE */
-    case 0x5f: /* FDIV */
     case 0x7a: /* FABD */
     case 0x7c: /* FCMGT */
         if (!fp_access_check(s)) {
@@ -14207,6 +14473,11 @@ static void disas_a64_insn(CPUARMState *env, DisasContext *s)
     s->base.pc_next += 4;
 
     s->fp_access_checked = false;
+    s->cc_src = s->cc_src_next;
+    s->cc_src_next.kind = A64_CC_SRC_NONE;
+    s->const_reg = s->const_reg_next;
+    s->const_val = s->const_val_next;
+    s->const_reg_next = -1;
 
     if (dc_isar_feature(aa64_bti, s)) {
         if (s->base.num_insns == 1) {
@@ -14353,6 +14624,8 @@ static void aarch64_tr_init_disas_context(DisasContextBase *dcbase,
     dc->ss_active = FIELD_EX32(tb_flags, TBFLAG_ANY, SS_ACTIVE);
     dc->pstate_ss = FIELD_EX32(tb_flags, TBFLAG_ANY, PSTATE_SS);
     dc->is_ldex = false;
+    dc->cc_src_next.kind = A64_CC_SRC_NONE;
+    dc->const_reg_next = -1;
     dc->debug_target_el = FIELD_EX32(tb_flags, TBFLAG_ANY, DEBUG_TARGET_EL);
 
     /* Bound the number of insns to execute to those left on the page.  */
@@ -6,6 +6,26 @@
 
 
 /* internal defines */
+/*
+ * Operands of an A64 CMP/TST whose result was discarded.  Recorded so that
+ * an immediately following B.cond/CSEL can compare them directly instead of
+ * reconstructing the condition from the NZCV globals.
+ */
+typedef enum A64CCSrcKind {
+    A64_CC_SRC_NONE,
+    A64_CC_SRC_SUB,     /* flags as for Rn - Op2 */
+    A64_CC_SRC_LOGIC,   /* flags as for Rn & Op2 */
+} A64CCSrcKind;
+
+typedef struct A64CCSrc {
+    A64CCSrcKind kind;
+    bool sf;
+    bool rn_sp;         /* register 31 as Rn names SP rather than XZR */
+    int rn;
+    int rm;             /* -1 when Op2 is imm */
+    uint64_t imm;
+} A64CCSrc;
+
 typedef struct DisasContext {
     DisasContextBase base;
     const ARMISARegisters *isar;
@@ -92,6 +112,17 @@ typedef struct DisasContext {
     int c15_cpar;
     /* TCG op of the current insn_start.  */
     TCGOp *insn_start;
+    /* CMP/TST set by the previous insn, and the one set by this insn.  */
+    A64CCSrc cc_src;
+    A64CCSrc cc_src_next;
+    /*
+     * Xn known to hold a constant after the previous insn, and the one
+     * set by this insn; -1 when there is none.
+     */
+    int const_reg;
+    int const_reg_next;
+    uint64_t const_val;
+    uint64_t const_val_next;
 #define TMP_A64_MAX 16
     int tmp_a64_count;
     TCGv_i64 tmp_a64[TMP_A64_MAX];
@@ -18,11 +18,20 @@
  */
 
 #include "qemu/osdep.h"
+#include <math.h>
+#include <float.h>
 #include "cpu.h"
 #include "exec/helper-proto.h"
 #include "tcg/tcg-gvec-desc.h"
 #include "fpu/softfloat.h"
 
+#if defined(TARGET_AARCH64) && defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(CONFIG_CPUID_H) && defined(__x86_64__)
+#include "qemu/cpuid.h"
+#include <wmmintrin.h>
+#endif
 
 /* Note that vector data is stored in host-endian 64-bit chunks,
    so addressing units smaller than that needs a host-endian fixup.  */
@@ -692,17 +701,92 @@ void HELPER(NAME)(void *vd, void *vn, void *vm, void *stat, uint32_t desc) \
     clear_tail(d, oprsz, simd_maxsz(desc));                                \
 }
 
+/*
+ * Whole-vector host FPU version of DO_3OP, in the style of the hardfloat
+ * paths in fpu/softfloat.c: when inexact is already set and the rounding
+ * mode is the host's, compute every lane with the host FPU, and keep the
+ * result only if each lane passed PRE (no NaN, infinity or denormal
+ * input) and POST (a finite result that cannot have underflowed), in
+ * which case softfloat would not have raised anything new either.
+ * Otherwise redo the whole vector with softfloat from the untouched
+ * inputs.  The lane loop is simple enough for the compiler to vectorize.
+ */
+#ifdef __FAST_MATH__
+#define vec_can_use_fpu(s)  false
+#else
+static inline bool vec_can_use_fpu(const float_status *s)
+{
+    return likely(s->float_exception_flags & float_flag_inexact &&
+                  s->float_rounding_mode == float_round_nearest_even);
+}
+#endif
+
+#define HF_ZON(x)  (isnormal(x) || (x) == 0)
+
+#define HF_PRE_ZON2(a, b)      (HF_ZON(a) && HF_ZON(b))
+#define HF_PRE_DIV(a, b)       (HF_ZON(a) && isnormal(b))
+#define HF_POST_ADD(a, b, r, MIN) \
+    (isfinite(r) && (fabs(r) > MIN || ((a) == 0 && (b) == 0)))
+#define HF_POST_MUL(a, b, r, MIN) \
+    (isfinite(r) && (fabs(r) > MIN || (a) == 0 || (b) == 0))
+#define HF_POST_DIV(a, b, r, MIN) \
+    (isfinite(r) && (fabs(r) > MIN || (a) == 0))
+
+#define DO_3OP_HARD(NAME, FUNC, TYPE, HTYPE, MIN, OP, PRE, POST)          \
+void HELPER(NAME)(void *vd, void *vn, void *vm, void *stat, uint32_t desc) \
+{                                                                          \
+    intptr_t i, oprsz = simd_oprsz(desc);                                  \
+    TYPE *d = vd, *n = vn, *m = vm;                                        \
+    if (vec_can_use_fpu(stat)) {                                           \
+        const HTYPE *hn = vn, *hm = vm;                                    \
+        HTYPE r[ARM_MAX_VQ * 16 / sizeof(HTYPE)];                          \
+        bool ok = true;                                                    \
+        for (i = 0; i < oprsz / sizeof(TYPE); i++) {                       \
+            r[i] = hn[i] OP hm[i];                                         \
+            ok &= PRE(hn[i], hm[i]) && POST(hn[i], hm[i], r[i], MIN);      \
+        }                                                                  \
+        if (likely(ok)) {                                                  \
+            memcpy(d, r, oprsz);                                           \
+            clear_tail(d, oprsz, simd_maxsz(desc));                        \
+            return;                                                        \
+        }                                                                  \
+    }                                                                      \
+    for (i = 0; i < oprsz / sizeof(TYPE); i++) {                           \
+        d[i] = FUNC(n[i], m[i], stat);                                     \
+    }                                                                      \
+    clear_tail(d, oprsz, simd_maxsz(desc));                                \
+}
+
 DO_3OP(gvec_fadd_h, float16_add, float16)
-DO_3OP(gvec_fadd_s, float32_add, float32)
-DO_3OP(gvec_fadd_d, float64_add, float64)
+DO_3OP_HARD(gvec_fadd_s, float32_add, float32, float, FLT_MIN, +,
+            HF_PRE_ZON2, HF_POST_ADD)
+DO_3OP_HARD(gvec_fadd_d, float64_add, float64, double, DBL_MIN, +,
+            HF_PRE_ZON2, HF_POST_ADD)
 
 DO_3OP(gvec_fsub_h, float16_sub, float16)
-DO_3OP(gvec_fsub_s, float32_sub, float32)
-DO_3OP(gvec_fsub_d, float64_sub, float64)
+DO_3OP_HARD(gvec_fsub_s, float32_sub, float32, float, FLT_MIN, -,
+            HF_PRE_ZON2, HF_POST_ADD)
+DO_3OP_HARD(gvec_fsub_d, float64_sub, float64, double, DBL_MIN, -,
+            HF_PRE_ZON2, HF_POST_ADD)
 
 DO_3OP(gvec_fmul_h, float16_mul, float16)
-DO_3OP(gvec_fmul_s, float32_mul, float32)
-DO_3OP(gvec_fmul_d, float64_mul, float64)
+DO_3OP_HARD(gvec_fmul_s, float32_mul, float32, float, FLT_MIN, *,
+            HF_PRE_ZON2, HF_POST_MUL)
+DO_3OP_HARD(gvec_fmul_d, float64_mul, float64, double, DBL_MIN, *,
+            HF_PRE_ZON2, HF_POST_MUL)
+
+DO_3OP_HARD(gvec_fdiv_s, float32_div, float32, float, FLT_MIN, /,
+            HF_PRE_DIV, HF_POST_DIV)
+DO_3OP_HARD(gvec_fdiv_d, float64_div, float64, double, DBL_MIN, /,
+            HF_PRE_DIV, HF_POST_DIV)
+
+#undef DO_3OP_HARD
+#undef HF_PRE_ZON2
+#undef HF_PRE_DIV
+#undef HF_POST_ADD
+#undef HF_POST_MUL
+#undef HF_POST_DIV
+#undef HF_ZON
 
 DO_3OP(gvec_ftsmul_h, float16_ftsmul, float16)
 DO_3OP(gvec_ftsmul_s, float32_ftsmul, float32)
@@ -1165,6 +1249,31 @@ void HELPER(gvec_pmul_b)(void *vd, void *vn, void *vm, uint32_t desc)
     clear_tail(d, opr_sz, simd_maxsz(desc));
 }
 
+#if defined(CONFIG_CPUID_H) && defined(__x86_64__)
+static bool have_pclmul;
+
+static void __attribute__((constructor)) init_pmull_accel(void)
+{
+    unsigned a, b, c, d;
+
+    if (__get_cpuid_max(0, NULL) >= 1) {
+        __cpuid(1, a, b, c, d);
+        have_pclmul = (c & bit_PCLMUL) != 0;
+    }
+}
+
+static void __attribute__((target("pclmul")))
+pclmul_pmull_q(uint64_t *d, uint64_t nn, uint64_t mm)
+{
+    __m128i r = _mm_clmulepi64_si128(_mm_cvtsi64_si128(nn),
+                                     _mm_cvtsi64_si128(mm), 0);
+    _mm_storeu_si128((__m128i *)d, r);
+}
+#else
+#define have_pclmul  false
+#define pclmul_pmull_q(d, nn, mm)  g_assert_not_reached()
+#endif
+
 /*
  * 64x64->128 polynomial multiply.
  * Because of the lanes are not accessed in strict columns,
@@ -1176,6 +1285,14 @@ void HELPER(gvec_pmull_q)(void *vd, void *vn, void *vm, uint32_t desc)
     intptr_t hi = simd_data(desc);
     uint64_t *d = vd, *n = vn, *m = vm;
 
+    if (have_pclmul) {
+        for (i = 0; i < opr_sz / 8; i += 2) {
+            pclmul_pmull_q(&d[i], n[i + hi], m[i + hi]);
+        }
+        clear_tail(d, opr_sz, simd_maxsz(desc));
+        return;
+    }
+
     for (i = 0; i < opr_sz / 8; i += 2) {
         uint64_t nn = n[i + hi];
         uint64_t mm = m[i + hi];
@@ -1257,3 +1374,77 @@ void HELPER(sve2_pmull_h)(void *vd, void *vn, void *vm, uint32_t desc)
     }
 }
 #endif
+
+#ifdef TARGET_AARCH64
+/*
+ * TBL/TBX: desc data holds the first table register in bits [4:0], the
+ * number of table registers minus one in bits [6:5] and TBX in bit 7.
+ * The table may wrap from V31 to V0, and Vd may overlap the table or the
+ * indices, so everything is read before Vd is written.
+ */
+void HELPER(simd_tbl)(void *vd, void *vm, CPUARMState *env, uint32_t desc)
+{
+    intptr_t opr_sz = simd_oprsz(desc);
+    int rn = extract32(simd_data(desc), 0, 5);
+    int numregs = extract32(simd_data(desc), 5, 2) + 1;
+    bool is_tbx = extract32(simd_data(desc), 7, 1);
+    uint64_t table[8], idx[2] = { }, res[2] = { };
+    int r;
+
+    for (r = 0; r < numregs; r++) {
+        uint64_t *q = aa64_vfp_qreg(env, (rn + r) % 32);
+        table[r * 2] = q[0];
+        table[r * 2 + 1] = q[1];
+    }
+    memcpy(idx, vm, opr_sz);
+    if (is_tbx) {
+        memcpy(res, vd, opr_sz);
+    }
+
+#ifdef __SSSE3__
+    {
+        /*
+         * PSHUFB looks up 16 bytes at once but only uses the low 4 bits
+         * of each index, zeroing the lane when bit 7 is set.  Rebase the
+         * indices onto each table register and push everything outside
+         * 0..15 into the top half with a saturating add.
+         */
+        __m128i vidx = _mm_loadu_si128((__m128i *)idx);
+        __m128i acc = _mm_setzero_si128();
+        __m128i inr;
+
+        for (r = 0; r < numregs; r++) {
+            __m128i t = _mm_sub_epi8(vidx, _mm_set1_epi8(16 * r));
+            t = _mm_adds_epu8(t, _mm_set1_epi8(0x70));
+            acc = _mm_or_si128(acc,
+                               _mm_shuffle_epi8(
+                                   _mm_loadu_si128((__m128i *)&table[r * 2]),
+                                   t));
+        }
+        if (is_tbx) {
+            inr = _mm_min_epu8(vidx, _mm_set1_epi8(16 * numregs - 1));
+            inr = _mm_cmpeq_epi8(inr, vidx);
+            acc = _mm_or_si128(_mm_and_si128(inr, acc),
+                               _mm_andnot_si128(inr,
+                                   _mm_loadu_si128((__m128i *)res)));
+        }
+        _mm_storeu_si128((__m128i *)res, acc);
+    }
+#else
+    {
+        intptr_t i;
+
+        for (i = 0; i < opr_sz; i++) {
+            unsigned index = ((uint8_t *)idx)[H1(i)];
+
+            if (index < 16 * numregs) {
+                ((uint8_t *)res)[H1(i)] = ((uint8_t *)table)[H1(index)];
+            }
+        }
+    }
+#endif
+
+    memcpy(vd, res, opr_sz);
+    clear_tail(vd, opr_sz, simd_maxsz(desc));
+}
+#endif
@@ -1631,14 +1631,9 @@ void tcg_register_blocks(struct Block_layout *block) {
     return;
 }
 
-// copy src block, and replace its callbacks with our x64 trampolines
-struct Block_layout *
-tcg_copy_replace_blocks(struct Block_layout *src) {
-    if (NULL == src)
-        return NULL;
-    
-    struct Block_layout *dst = block_copy_to_heap_or_not(src);
-    
+// replace callbacks of a copied block with our x64 trampolines
+static void
+tcg_replace_block_callbacks(struct Block_layout *dst, bool new_descriptor) {
     BlockInvokeFunction invoke = block_get_invoke(dst);
     const char *signature = block_get_signature(dst);
     if (invoke) {
@@ -1648,13 +1643,22 @@ tcg_copy_replace_blocks(struct Block_layout *src) {
         }
         block_set_invoke(dst, callback_query_and_add_trampoline((void *)invoke, signature));
     }
+    // copy/dispose live in the descriptor, which is shared by blocks of the
+    // same literal. Replace them only once.
+    if (!new_descriptor)
+        return;
     BlockCopyFunction copy;
     BlockDisposeFunction dispose;
     block_get_copy_dispose(dst, &copy, &dispose);
     block_set_copy_dispose(dst,
                            callback_query_and_add_trampoline((void *)copy, block_copy_types),
                            callback_query_and_add_trampoline((void *)dispose, block_dispose_types));
-    return dst;
+}
+
+// copy src block, and replace its callbacks with our x64 trampolines
+struct Block_layout *
+tcg_copy_replace_blocks(struct Block_layout *src) {
+    return block_copy_to_heap_or_not(src, tcg_replace_block_callbacks);
 }
 
 void tcg_register_struct_with_fn_ptr(uint8_t *stptr, const char *fnName, int argIdx, uint32_t *offsetList) {
@@ -116,6 +116,7 @@ tcg_gen_objc_trampoline(TCGContext *s, Method method, uint32_t mark)
 }
 
 const char *tcg_query_callback_type(target_ulong pc);
+const char *tcg_query_callback_type_nolock(target_ulong pc);
 
 void abi_x2a_get_translation_function_pair_by_pc(target_ulong pc,
                                                  fnEntryTranslation *entry_translation,
@@ -830,6 +831,7 @@ void tcg_register_callback_as_type(target_ulong pc, const char *types)
     }
     
     g_hash_table_insert(callback_types, (gpointer)pc, (gpointer)types);
+    native_pc_forget(pc);
     mmap_unlock();
 }
 
@@ -840,6 +842,7 @@ void tcg_register_callback_as_type_nolock(target_ulong pc, const char *types)
     }
     
     g_hash_table_insert(callback_types, (gpointer)pc, (gpointer)types);
+    native_pc_forget(pc);
 }
 
 const char *tcg_query_callback_type(target_ulong pc)
@@ -848,13 +851,16 @@ const char *tcg_query_callback_type(target_ulong pc)
     const char *r;
     
     mmap_lock();
-    r = g_hash_table_lookup(callback_types, (gconstpointer)pc);
+    r = tcg_query_callback_type_nolock(pc);
     mmap_unlock();
     return r;
 }
 
 const char *tcg_query_callback_type_nolock(target_ulong pc)
 {
+    if (NULL == callback_types) {
+        return NULL;
+    }
     return g_hash_table_lookup(callback_types, (gconstpointer)pc);
 }
 
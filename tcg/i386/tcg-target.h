@@ -233,6 +233,13 @@ static inline void tb_target_set_jmp_target(uintptr_t tc_ptr,
 #ifdef CONFIG_SOFTMMU
 #define TCG_TARGET_NEED_LDST_LABELS
 #endif
+
+/* Guest atomics as locked host insns on the guest address, user-mode only */
+#if defined(CONFIG_SOFTMMU) || TCG_TARGET_REG_BITS == 32
+#define TCG_TARGET_HAS_atomic_rmw    0
+#else
+#define TCG_TARGET_HAS_atomic_rmw    1
+#endif
 #define TCG_TARGET_NEED_POOL_LABELS
 
 #endif
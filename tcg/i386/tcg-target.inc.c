@@ -489,6 +489,9 @@ static inline int tcg_target_const_match(tcg_target_long val, TCGType type,
 #define OPC_VPSRLVQ     (0x45 | P_EXT38 | P_DATA16 | P_REXW)
 #define OPC_VZEROUPPER  (0x77 | P_EXT)
 #define OPC_XCHG_ax_r32	(0x90)
+#define OPC_XCHG_EvGv	(0x87)
+#define OPC_XADD_EvGv	(0xc1 | P_EXT)
+#define OPC_CMPXCHG_EvGv	(0xb1 | P_EXT)
 
 #define OPC_GRP3_Ev	(0xf7)
 #define OPC_GRP5	(0xff)
@@ -2710,6 +2713,33 @@ static inline void tcg_out_op(TCGContext *s, TCGOpcode opc,
     case INDEX_op_mb:
         tcg_out_mb(s, a0);
         break;
+
+#if TCG_TARGET_HAS_atomic_rmw
+    /*
+     * User-mode guest memory is host memory, so these are the plain
+     * locked insns on the guest address. The value operand is also the
+     * output, and for cmpxchg the comparison value is in %eax.
+     */
+    OP_32_64(atomic_fetch_add):
+        tcg_out8(s, 0xf0);
+        tcg_out_modrm_sib_offset(s, OPC_XADD_EvGv + rexw + x86_guest_base_seg,
+                                 a0, a1, x86_guest_base_index, 0,
+                                 x86_guest_base_offset);
+        break;
+    OP_32_64(atomic_xchg):
+        /* xchg with memory is implicitly locked */
+        tcg_out_modrm_sib_offset(s, OPC_XCHG_EvGv + rexw + x86_guest_base_seg,
+                                 a0, a1, x86_guest_base_index, 0,
+                                 x86_guest_base_offset);
+        break;
+    OP_32_64(atomic_cmpxchg):
+        tcg_out8(s, 0xf0);
+        tcg_out_modrm_sib_offset(s, OPC_CMPXCHG_EvGv + rexw
+                                 + x86_guest_base_seg,
+                                 args[3], a1, x86_guest_base_index, 0,
+                                 x86_guest_base_offset);
+        break;
+#endif
     case INDEX_op_mov_i32:  /* Always emitted via tcg_out_mov.  */
     case INDEX_op_mov_i64:
     case INDEX_op_movi_i32: /* Always emitted via tcg_out_movi.  */
@@ -3021,6 +3051,9 @@ static const TCGTargetOpDef *tcg_target_op_def(TCGOpcode op)
     static const TCGTargetOpDef r_0_r = { .args_ct_str = { "r", "0", "r" } };
     static const TCGTargetOpDef r_0_re = { .args_ct_str = { "r", "0", "re" } };
     static const TCGTargetOpDef r_0_ci = { .args_ct_str = { "r", "0", "ci" } };
+    static const TCGTargetOpDef r_r_0 = { .args_ct_str = { "r", "r", "0" } };
+    static const TCGTargetOpDef a_r_0_r
+        = { .args_ct_str = { "a", "r", "0", "r" } };
     static const TCGTargetOpDef r_L = { .args_ct_str = { "r", "L" } };
     static const TCGTargetOpDef L_L = { .args_ct_str = { "L", "L" } };
     static const TCGTargetOpDef r_L_L = { .args_ct_str = { "r", "L", "L" } };
@@ -3228,6 +3261,15 @@ static const TCGTargetOpDef *tcg_target_op_def(TCGOpcode op)
                 : TARGET_LONG_BITS <= TCG_TARGET_REG_BITS ? &L_L_L
                 : &L_L_L_L);
 
+    case INDEX_op_atomic_fetch_add_i32:
+    case INDEX_op_atomic_fetch_add_i64:
+    case INDEX_op_atomic_xchg_i32:
+    case INDEX_op_atomic_xchg_i64:
+        return &r_r_0;
+    case INDEX_op_atomic_cmpxchg_i32:
+    case INDEX_op_atomic_cmpxchg_i64:
+        return &a_r_0_r;
+
     case INDEX_op_brcond2_i32:
         {
             static const TCGTargetOpDef b2
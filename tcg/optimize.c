@@ -41,8 +41,25 @@ struct tcg_temp_info {
     TCGTemp *next_copy;
     tcg_target_ulong val;
     tcg_target_ulong mask;
+    /* Bits known to be copies of bit 63; only tracked for 64-bit values. */
+    uint64_t smask;
 };
 
+/* Nothing known beyond bit 63 being equal to itself.  */
+#define SMASK_NONE  (1ull << 63)
+
+/* The sign-bit copies implied by a value's known-zero leading bits.  */
+static uint64_t smask_from_zmask(uint64_t zmask)
+{
+    int rep = clz64(zmask);
+    return rep ? -1ull << (64 - rep) : SMASK_NONE;
+}
+
+static uint64_t smask_from_value(uint64_t val)
+{
+    return -1ull << (63 - clrsb64(val));
+}
+
 static inline struct tcg_temp_info *ts_info(TCGTemp *ts)
 {
     return ts->state_ptr;
@@ -81,6 +98,7 @@ static void reset_ts(TCGTemp *ts)
     ti->prev_copy = ts;
     ti->is_const = false;
     ti->mask = -1;
+    ti->smask = SMASK_NONE;
 }
 
 static void reset_temp(TCGArg arg)
@@ -101,6 +119,7 @@ static void init_ts_info(struct tcg_temp_info *infos,
         ti->prev_copy = ts;
         ti->is_const = false;
         ti->mask = -1;
+        ti->smask = SMASK_NONE;
         set_bit(idx, temps_used->l);
     }
 }
@@ -195,6 +214,8 @@ static void tcg_opt_gen_movi(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg val)
         mask |= ~0xffffffffull;
     }
     di->mask = mask;
+    di->smask = new_op == INDEX_op_movi_i64 ? smask_from_value(val)
+                                            : SMASK_NONE;
 }
 
 static void tcg_opt_gen_mov(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg src)
@@ -234,6 +255,7 @@ static void tcg_opt_gen_mov(TCGContext *s, TCGOp *op, TCGArg dst, TCGArg src)
         mask |= ~0xffffffffull;
     }
     di->mask = mask;
+    di->smask = new_op == INDEX_op_mov_i64 ? si->smask : SMASK_NONE;
 
     if (src_ts->type == dst_ts->type) {
         struct tcg_temp_info *ni = ts_info(si->next_copy);
@@ -513,15 +535,44 @@ static TCGArg do_constant_folding_cond(TCGOpcode op, TCGArg x,
         }
     } else if (args_are_copies(x, y)) {
         return do_constant_folding_cond_eq(c);
-    } else if (arg_is_const(y) && yv == 0) {
+    } else if (arg_is_const(y)) {
+        /* The known-zero bits of X bound it to [0, zmask].  */
+        tcg_target_ulong zmask = arg_info(x)->mask;
+        TCGArg ret = 2;
+
+        if (!(tcg_op_defs[op].flags & TCG_OPF_64BIT)) {
+            zmask = (uint32_t)zmask;
+            yv = (uint32_t)yv;
+        }
         switch (c) {
         case TCG_COND_LTU:
-            return 0;
+            ret = yv == 0 ? 0 : zmask < yv ? 1 : 2;
+            break;
         case TCG_COND_GEU:
-            return 1;
+            ret = yv == 0 ? 1 : zmask < yv ? 0 : 2;
+            break;
+        case TCG_COND_LEU:
+            ret = zmask <= yv ? 1 : 2;
+            break;
+        case TCG_COND_GTU:
+            ret = zmask <= yv ? 0 : 2;
+            break;
+        case TCG_COND_EQ:
+            ret = yv & ~zmask ? 0 : 2;
+            break;
+        case TCG_COND_NE:
+            ret = yv & ~zmask ? 1 : 2;
+            break;
         default:
-            return 2;
+            break;
         }
+#ifdef CONFIG_PROFILER
+        if (ret != 2) {
+            atomic_set(&tcg_ctx->prof.kb_fold_count,
+                       tcg_ctx->prof.kb_fold_count + 1);
+        }
+#endif
+        return ret;
     }
     return 2;
 }
@@ -614,6 +665,7 @@ void tcg_optimize(TCGContext *s)
 
     QTAILQ_FOREACH_SAFE(op, &s->ops, link, op_next) {
         tcg_target_ulong mask, partmask, affected;
+        uint64_t smask;
         int nb_oargs, nb_iargs, i;
         TCGArg tmp;
         TCGOpcode opc = op->opc;
@@ -846,6 +898,35 @@ void tcg_optimize(TCGContext *s)
             break;
         }
 
+        /* Drop sign extensions of values that are already sign-extended
+           from at least as narrow a width.  */
+        smask = 0;
+        switch (opc) {
+        case INDEX_op_ext8s_i64:
+            smask = -1ull << 7;
+            break;
+        case INDEX_op_ext16s_i64:
+            smask = -1ull << 15;
+            break;
+        case INDEX_op_ext32s_i64:
+            smask = -1ull << 31;
+            break;
+        case INDEX_op_sextract_i64:
+            if (op->args[2] == 0) {
+                smask = -1ull << (op->args[3] - 1);
+            }
+            break;
+        default:
+            break;
+        }
+        if (smask && (arg_info(op->args[1])->smask & smask) == smask) {
+#ifdef CONFIG_PROFILER
+            atomic_set(&s->prof.kb_fold_count, s->prof.kb_fold_count + 1);
+#endif
+            tcg_opt_gen_mov(s, op, op->args[0], op->args[1]);
+            continue;
+        }
+
         /* Simplify using known-zero bits. Currently only ops with a single
            output argument is supported. */
         mask = -1;
@@ -1045,6 +1126,65 @@ void tcg_optimize(TCGContext *s)
             continue;
         }
 
+        /* Sign-bit copies of the first output, for 64-bit ops.  */
+        smask = SMASK_NONE;
+        if (def->flags & TCG_OPF_64BIT) {
+            switch (opc) {
+            case INDEX_op_ext8s_i64:
+            case INDEX_op_ld8s_i64:
+                smask = -1ull << 7;
+                break;
+            case INDEX_op_ext16s_i64:
+            case INDEX_op_ld16s_i64:
+                smask = -1ull << 15;
+                break;
+            case INDEX_op_ext32s_i64:
+            case INDEX_op_ext_i32_i64:
+            case INDEX_op_ld32s_i64:
+                smask = -1ull << 31;
+                break;
+            case INDEX_op_sextract_i64:
+                smask = -1ull << (op->args[3] - 1);
+                break;
+            case INDEX_op_sar_i64:
+                if (arg_is_const(op->args[2])) {
+                    tmp = arg_info(op->args[2])->val & 63;
+                    smask = (int64_t)arg_info(op->args[1])->smask >> tmp;
+                }
+                break;
+            case INDEX_op_and_i64:
+            case INDEX_op_or_i64:
+            case INDEX_op_xor_i64:
+            case INDEX_op_andc_i64:
+            case INDEX_op_orc_i64:
+            case INDEX_op_eqv_i64:
+            case INDEX_op_nand_i64:
+            case INDEX_op_nor_i64:
+                smask = arg_info(op->args[1])->smask
+                        & arg_info(op->args[2])->smask;
+                break;
+            case INDEX_op_not_i64:
+                smask = arg_info(op->args[1])->smask;
+                break;
+            case INDEX_op_movcond_i64:
+                smask = arg_info(op->args[3])->smask
+                        & arg_info(op->args[4])->smask;
+                break;
+            case INDEX_op_qemu_ld_i64:
+                {
+                    TCGMemOpIdx oi = op->args[nb_oargs + nb_iargs];
+                    MemOp mop = get_memop(oi);
+                    if (mop & MO_SIGN) {
+                        smask = -1ull << ((8 << (mop & MO_SIZE)) - 1);
+                    }
+                }
+                break;
+            default:
+                break;
+            }
+            smask |= smask_from_zmask(mask);
+        }
+
         /* Simplify expression for "op r, a, 0 => movi r, 0" cases */
         switch (opc) {
         CASE_OP_32_64_VEC(and):
@@ -1488,6 +1628,7 @@ void tcg_optimize(TCGContext *s)
                        first output argument (only one supported so far). */
                     if (i == 0) {
                         arg_info(op->args[i])->mask = mask;
+                        arg_info(op->args[i])->smask = smask;
                     }
                 }
             }
@@ -1523,6 +1664,12 @@ void tcg_optimize(TCGContext *s)
             case INDEX_op_qemu_ld_i64:
             case INDEX_op_qemu_st_i32:
             case INDEX_op_qemu_st_i64:
+            case INDEX_op_atomic_fetch_add_i32:
+            case INDEX_op_atomic_xchg_i32:
+            case INDEX_op_atomic_cmpxchg_i32:
+            case INDEX_op_atomic_fetch_add_i64:
+            case INDEX_op_atomic_xchg_i64:
+            case INDEX_op_atomic_cmpxchg_i64:
             case INDEX_op_call:
                 /* Opcodes that touch guest memory stop the optimization.  */
                 prev_mb = NULL;
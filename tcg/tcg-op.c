@@ -3063,6 +3063,18 @@ typedef void (*gen_atomic_op_i64)(TCGv_i64, TCGv_env, TCGv, TCGv_i64);
 # define WITH_ATOMIC64(X)
 #endif
 
+/*
+ * When guest memory is host memory, fetch_add, xchg and cmpxchg on host
+ * endian 32 and 64-bit words are done by the backend without a helper
+ * call, see TCG_TARGET_HAS_atomic_rmw.
+ */
+#if TCG_TARGET_HAS_atomic_rmw && TARGET_LONG_BITS == 64
+#define HOST_ATOMIC_RMW
+#endif
+
+/* host_opc of the atomic ops that always go through a helper */
+#define NO_HOST_OP  NB_OPS
+
 static void * const table_cmpxchg[16] = {
     [MO_8] = gen_helper_atomic_cmpxchgb,
     [MO_16 | MO_LE] = gen_helper_atomic_cmpxchgw_le,
@@ -3095,6 +3107,12 @@ void tcg_gen_atomic_cmpxchg_i32(TCGv_i32 retv, TCGv addr, TCGv_i32 cmpv,
             tcg_gen_mov_i32(retv, t1);
         }
         tcg_temp_free_i32(t1);
+#ifdef HOST_ATOMIC_RMW
+    } else if ((memop & (MO_SIZE | MO_BSWAP)) == MO_32) {
+        tcg_gen_op5(INDEX_op_atomic_cmpxchg_i32, tcgv_i32_arg(retv),
+                    tcgv_i64_arg(addr), tcgv_i32_arg(cmpv),
+                    tcgv_i32_arg(newv), make_memop_idx(memop & ~MO_SIGN, idx));
+#endif
     } else {
         gen_atomic_cx_i32 gen;
 
@@ -3139,6 +3157,12 @@ void tcg_gen_atomic_cmpxchg_i64(TCGv_i64 retv, TCGv addr, TCGv_i64 cmpv,
             tcg_gen_mov_i64(retv, t1);
         }
         tcg_temp_free_i64(t1);
+#ifdef HOST_ATOMIC_RMW
+    } else if ((memop & (MO_SIZE | MO_BSWAP)) == MO_64) {
+        tcg_gen_op5(INDEX_op_atomic_cmpxchg_i64, tcgv_i64_arg(retv),
+                    tcgv_i64_arg(addr), tcgv_i64_arg(cmpv),
+                    tcgv_i64_arg(newv), make_memop_idx(memop, idx));
+#endif
     } else if ((memop & MO_SIZE) == MO_64) {
 #ifdef CONFIG_ATOMIC64
         gen_atomic_cx_i64 gen;
@@ -3199,13 +3223,27 @@ static void do_nonatomic_op_i32(TCGv_i32 ret, TCGv addr, TCGv_i32 val,
     tcg_temp_free_i32(t2);
 }
 
+/*
+ * @host_opc is the opcode doing the operation on a host endian word
+ * without a helper call, or NO_HOST_OP.
+ */
 static void do_atomic_op_i32(TCGv_i32 ret, TCGv addr, TCGv_i32 val,
-                             TCGArg idx, MemOp memop, void * const table[])
+                             TCGArg idx, MemOp memop, void * const table[],
+                             TCGOpcode host_opc)
 {
     gen_atomic_op_i32 gen;
 
     memop = tcg_canonicalize_memop(memop, 0, 0);
 
+#ifdef HOST_ATOMIC_RMW
+    if ((memop & (MO_SIZE | MO_BSWAP)) == MO_32 && host_opc != NO_HOST_OP) {
+        tcg_gen_op4(host_opc,
+                    tcgv_i32_arg(ret), tcgv_i64_arg(addr), tcgv_i32_arg(val),
+                    make_memop_idx(memop & ~MO_SIGN, idx));
+        return;
+    }
+#endif
+
     gen = table[memop & (MO_SIZE | MO_BSWAP)];
     tcg_debug_assert(gen != NULL);
 
@@ -3242,11 +3280,22 @@ static void do_nonatomic_op_i64(TCGv_i64 ret, TCGv addr, TCGv_i64 val,
     tcg_temp_free_i64(t2);
 }
 
+/* @host_opc_i32 is used for narrower accesses, see do_atomic_op_i32. */
 static void do_atomic_op_i64(TCGv_i64 ret, TCGv addr, TCGv_i64 val,
-                             TCGArg idx, MemOp memop, void * const table[])
+                             TCGArg idx, MemOp memop, void * const table[],
+                             TCGOpcode host_opc_i32, TCGOpcode host_opc_i64)
 {
     memop = tcg_canonicalize_memop(memop, 1, 0);
 
+#ifdef HOST_ATOMIC_RMW
+    if ((memop & (MO_SIZE | MO_BSWAP)) == MO_64 && host_opc_i64 != NO_HOST_OP) {
+        tcg_gen_op4(host_opc_i64,
+                    tcgv_i64_arg(ret), tcgv_i64_arg(addr), tcgv_i64_arg(val),
+                    make_memop_idx(memop & ~MO_SIGN, idx));
+        return;
+    }
+#endif
+
     if ((memop & MO_SIZE) == MO_64) {
 #ifdef CONFIG_ATOMIC64
         gen_atomic_op_i64 gen;
@@ -3274,7 +3323,8 @@ static void do_atomic_op_i64(TCGv_i64 ret, TCGv addr, TCGv_i64 val,
         TCGv_i32 r32 = tcg_temp_new_i32();
 
         tcg_gen_extrl_i64_i32(v32, val);
-        do_atomic_op_i32(r32, addr, v32, idx, memop & ~MO_SIGN, table);
+        do_atomic_op_i32(r32, addr, v32, idx, memop & ~MO_SIGN, table,
+                         host_opc_i32);
         tcg_temp_free_i32(v32);
 
         tcg_gen_extu_i32_i64(ret, r32);
@@ -3286,7 +3336,7 @@ static void do_atomic_op_i64(TCGv_i64 ret, TCGv addr, TCGv_i64 val,
     }
 }
 
-#define GEN_ATOMIC_HELPER(NAME, OP, NEW)                                \
+#define GEN_ATOMIC_HELPER(NAME, OP, NEW, HOST_I32, HOST_I64)            \
 static void * const table_##NAME[16] = {                                \
     [MO_8] = gen_helper_atomic_##NAME##b,                               \
     [MO_16 | MO_LE] = gen_helper_atomic_##NAME##w_le,                   \
@@ -3300,7 +3350,8 @@ void tcg_gen_atomic_##NAME##_i32                                        \
     (TCGv_i32 ret, TCGv addr, TCGv_i32 val, TCGArg idx, MemOp memop)    \
 {                                                                       \
     if (1/*tcg_ctx->tb_cflags & CF_PARALLEL*/) {                        \
-        do_atomic_op_i32(ret, addr, val, idx, memop, table_##NAME);     \
+        do_atomic_op_i32(ret, addr, val, idx, memop, table_##NAME,      \
+                         HOST_I32);                                     \
     } else {                                                            \
         do_nonatomic_op_i32(ret, addr, val, idx, memop, NEW,            \
                             tcg_gen_##OP##_i32);                        \
@@ -3310,30 +3361,32 @@ void tcg_gen_atomic_##NAME##_i64                                        \
     (TCGv_i64 ret, TCGv addr, TCGv_i64 val, TCGArg idx, MemOp memop)    \
 {                                                                       \
     if (1/*tcg_ctx->tb_cflags & CF_PARALLEL*/) {                        \
-        do_atomic_op_i64(ret, addr, val, idx, memop, table_##NAME);     \
+        do_atomic_op_i64(ret, addr, val, idx, memop, table_##NAME,      \
+                         HOST_I32, HOST_I64);                           \
     } else {                                                            \
         do_nonatomic_op_i64(ret, addr, val, idx, memop, NEW,            \
                             tcg_gen_##OP##_i64);                        \
     }                                                                   \
 }
 
-GEN_ATOMIC_HELPER(fetch_add, add, 0)
-GEN_ATOMIC_HELPER(fetch_and, and, 0)
-GEN_ATOMIC_HELPER(fetch_or, or, 0)
-GEN_ATOMIC_HELPER(fetch_xor, xor, 0)
-GEN_ATOMIC_HELPER(fetch_smin, smin, 0)
-GEN_ATOMIC_HELPER(fetch_umin, umin, 0)
-GEN_ATOMIC_HELPER(fetch_smax, smax, 0)
-GEN_ATOMIC_HELPER(fetch_umax, umax, 0)
-
-GEN_ATOMIC_HELPER(add_fetch, add, 1)
-GEN_ATOMIC_HELPER(and_fetch, and, 1)
-GEN_ATOMIC_HELPER(or_fetch, or, 1)
-GEN_ATOMIC_HELPER(xor_fetch, xor, 1)
-GEN_ATOMIC_HELPER(smin_fetch, smin, 1)
-GEN_ATOMIC_HELPER(umin_fetch, umin, 1)
-GEN_ATOMIC_HELPER(smax_fetch, smax, 1)
-GEN_ATOMIC_HELPER(umax_fetch, umax, 1)
+GEN_ATOMIC_HELPER(fetch_add, add, 0,
+                  INDEX_op_atomic_fetch_add_i32, INDEX_op_atomic_fetch_add_i64)
+GEN_ATOMIC_HELPER(fetch_and, and, 0, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(fetch_or, or, 0, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(fetch_xor, xor, 0, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(fetch_smin, smin, 0, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(fetch_umin, umin, 0, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(fetch_smax, smax, 0, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(fetch_umax, umax, 0, NO_HOST_OP, NO_HOST_OP)
+
+GEN_ATOMIC_HELPER(add_fetch, add, 1, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(and_fetch, and, 1, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(or_fetch, or, 1, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(xor_fetch, xor, 1, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(smin_fetch, smin, 1, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(umin_fetch, umin, 1, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(smax_fetch, smax, 1, NO_HOST_OP, NO_HOST_OP)
+GEN_ATOMIC_HELPER(umax_fetch, umax, 1, NO_HOST_OP, NO_HOST_OP)
 
 static void tcg_gen_mov2_i32(TCGv_i32 r, TCGv_i32 a, TCGv_i32 b)
 {
@@ -3345,6 +3398,7 @@ static void tcg_gen_mov2_i64(TCGv_i64 r, TCGv_i64 a, TCGv_i64 b)
     tcg_gen_mov_i64(r, b);
 }
 
-GEN_ATOMIC_HELPER(xchg, mov2, 0)
+GEN_ATOMIC_HELPER(xchg, mov2, 0,
+                  INDEX_op_atomic_xchg_i32, INDEX_op_atomic_xchg_i64)
 
 #undef GEN_ATOMIC_HELPER
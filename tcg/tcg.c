@@ -978,6 +978,7 @@ void tcg_context_init(TCGContext *s)
     
     s->trampolines = g_hash_table_new(NULL, NULL);
     s->addr_to_symbolname = g_hash_table_new(NULL, NULL);
+    s->tier1_pcs = g_hash_table_new(NULL, NULL);
 
     tcg_target_init(s);
     process_op_defs(s);
@@ -1146,6 +1147,8 @@ void tcg_func_start(TCGContext *s)
 
     QTAILQ_INIT(&s->ops);
     QTAILQ_INIT(&s->free_ops);
+    QTAILQ_INIT(&s->cold_ops);
+    s->cold_mark = NULL;
     QSIMPLEQ_INIT(&s->labels);
 }
 
@@ -1431,6 +1434,14 @@ bool tcg_op_supported(TCGOpcode op)
     case INDEX_op_goto_ptr:
         return TCG_TARGET_HAS_goto_ptr;
 
+    case INDEX_op_atomic_fetch_add_i32:
+    case INDEX_op_atomic_xchg_i32:
+    case INDEX_op_atomic_cmpxchg_i32:
+    case INDEX_op_atomic_fetch_add_i64:
+    case INDEX_op_atomic_xchg_i64:
+    case INDEX_op_atomic_cmpxchg_i64:
+        return TCG_TARGET_HAS_atomic_rmw;
+
     case INDEX_op_mov_i32:
     case INDEX_op_movi_i32:
     case INDEX_op_setcond_i32:
@@ -2362,6 +2373,35 @@ TCGOp *tcg_emit_op(TCGOpcode opc)
     return op;
 }
 
+/*
+ * The ops emitted between tcg_gen_cold_start and tcg_gen_cold_end are
+ * placed after the final exit of the TB, so that the fast path is
+ * contiguous and falls through. The region must begin with a label that
+ * is only reached by branches and end with an unconditional branch or
+ * exit. It is not covered by the insn_start data, so it must not contain
+ * anything that can fault or restore the guest state.
+ */
+void tcg_gen_cold_start(void)
+{
+    TCGContext *s = tcg_ctx;
+
+    tcg_debug_assert(s->cold_mark == NULL);
+    s->cold_mark = tcg_last_op();
+    tcg_debug_assert(s->cold_mark != NULL);
+}
+
+void tcg_gen_cold_end(void)
+{
+    TCGContext *s = tcg_ctx;
+    TCGOp *op;
+
+    while ((op = QTAILQ_NEXT(s->cold_mark, link)) != NULL) {
+        QTAILQ_REMOVE(&s->ops, op, link);
+        QTAILQ_INSERT_TAIL(&s->cold_ops, op, link);
+    }
+    s->cold_mark = NULL;
+}
+
 TCGOp *tcg_op_insert_before(TCGContext *s, TCGOp *old_op, TCGOpcode opc)
 {
     TCGOp *new_op = tcg_op_alloc(opc);
@@ -3184,10 +3224,68 @@ static void tcg_reg_free(TCGContext *s, TCGReg reg, TCGRegSet allocated_regs)
 {
     TCGTemp *ts = s->reg_to_temp[reg];
     if (ts != NULL) {
+#ifdef CONFIG_PROFILER
+        if (!ts->mem_coherent && !ts->fixed_reg) {
+            atomic_set(&s->prof.spill_count, s->prof.spill_count + 1);
+        }
+#endif
         temp_sync(s, ts, allocated_regs, 0, -1);
     }
 }
 
+/*
+ * Weighted register allocation, for tier 1 TBs or with
+ * tcg_weighted_regalloc. Once liveness is done, ts->state is free to hold
+ * the number of uses of each temp left in the TB. The register to spill
+ * is then the one whose eviction costs least: a store if the memory slot
+ * is stale, plus a reload per remaining use. Globals with many uses are
+ * loaded into call-saved registers so that they stay there across helper
+ * calls that do not touch globals.
+ */
+bool tcg_weighted_regalloc;
+
+#define TCG_HOT_GLOBAL_USES  4
+
+static void tcg_count_op_uses(TCGContext *s, TCGOp *op, int delta)
+{
+    const TCGOpDef *def = &tcg_op_defs[op->opc];
+    int i, nb_args;
+
+    if (op->opc == INDEX_op_call) {
+        nb_args = TCGOP_CALLO(op) + TCGOP_CALLI(op);
+    } else {
+        nb_args = def->nb_oargs + def->nb_iargs;
+    }
+    for (i = 0; i < nb_args; i++) {
+        if (op->args[i] != TCG_CALL_DUMMY_ARG) {
+            arg_temp(op->args[i])->state += delta;
+        }
+    }
+}
+
+static void tcg_count_uses(TCGContext *s)
+{
+    TCGOp *op;
+    int i;
+
+    for (i = 0; i < s->nb_temps; i++) {
+        s->temps[i].state = 0;
+    }
+    QTAILQ_FOREACH(op, &s->ops, link) {
+        tcg_count_op_uses(s, op, 1);
+    }
+}
+
+static unsigned tcg_spill_cost(TCGContext *s, TCGReg reg)
+{
+    TCGTemp *ts = s->reg_to_temp[reg];
+
+    if (ts == NULL) {
+        return 0;
+    }
+    return !ts->mem_coherent + ts->state;
+}
+
 /**
  * tcg_reg_alloc:
  * @required_regs: Set of registers in which we must allocate.
@@ -3246,6 +3344,24 @@ static TCGReg tcg_reg_alloc(TCGContext *s, TCGRegSet required_regs,
             TCGReg reg = tcg_regset_first(set);
             tcg_reg_free(s, reg, allocated_regs);
             return reg;
+        } else if (s->weighted_regalloc) {
+            int best = -1;
+            unsigned cost, best_cost = UINT_MAX;
+
+            for (i = 0; i < n; i++) {
+                TCGReg reg = order[i];
+                if (tcg_regset_test_reg(set, reg)) {
+                    cost = tcg_spill_cost(s, reg);
+                    if (cost < best_cost) {
+                        best = reg;
+                        best_cost = cost;
+                    }
+                }
+            }
+            if (best >= 0) {
+                tcg_reg_free(s, best, allocated_regs);
+                return best;
+            }
         } else {
             for (i = 0; i < n; i++) {
                 TCGReg reg = order[i];
@@ -3281,6 +3397,9 @@ static void temp_load(TCGContext *s, TCGTemp *ts, TCGRegSet desired_regs,
                             preferred_regs, ts->indirect_base);
         tcg_out_ld(s, ts->type, reg, ts->mem_base->reg, ts->mem_offset);
         ts->mem_coherent = 1;
+#ifdef CONFIG_PROFILER
+        atomic_set(&s->prof.reload_count, s->prof.reload_count + 1);
+#endif
         break;
     case TEMP_VAL_DEAD:
     default:
@@ -3664,6 +3783,12 @@ static void tcg_reg_alloc_op(TCGContext *s, const TCGOp *op)
             }
         }
 
+        if (s->weighted_regalloc && ts->temp_global && !i_preferred_regs
+            && ts->state >= TCG_HOT_GLOBAL_USES) {
+            i_preferred_regs = tcg_target_available_regs[ts->type]
+                               & ~tcg_target_call_clobber_regs;
+        }
+
         temp_load(s, ts, arg_ct->u.regs, i_allocated_regs, i_preferred_regs);
         reg = ts->reg;
 
@@ -3953,6 +4078,7 @@ void tcg_profile_snapshot(TCGProfile *prof, bool counters, bool table)
             PROF_ADD(prof, orig, temp_count);
             PROF_MAX(prof, orig, temp_count_max);
             PROF_ADD(prof, orig, del_op_count);
+            PROF_ADD(prof, orig, kb_fold_count);
             PROF_ADD(prof, orig, code_in_len);
             PROF_ADD(prof, orig, code_out_len);
             PROF_ADD(prof, orig, search_out_len);
@@ -3962,6 +4088,8 @@ void tcg_profile_snapshot(TCGProfile *prof, bool counters, bool table)
             PROF_ADD(prof, orig, opt_time);
             PROF_ADD(prof, orig, restore_count);
             PROF_ADD(prof, orig, restore_time);
+            PROF_ADD(prof, orig, spill_count);
+            PROF_ADD(prof, orig, reload_count);
         }
         if (table) {
             int i;
@@ -4034,6 +4162,12 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
     int i, num_insns;
     TCGOp *op;
 
+    /* Move the cold regions after the final exit.  */
+    while ((op = QTAILQ_FIRST(&s->cold_ops)) != NULL) {
+        QTAILQ_REMOVE(&s->cold_ops, op, link);
+        QTAILQ_INSERT_TAIL(&s->ops, op, link);
+    }
+
 #ifdef CONFIG_PROFILER
     {
         int n = 0;
@@ -4087,7 +4221,10 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
 #endif
 
 #ifdef USE_TCG_OPTIMIZATIONS
-    tcg_optimize(s);
+    /* Tier 0 TBs trade code quality for translation speed. */
+    if (!(tb_cflags(tb) & CF_TIER0)) {
+        tcg_optimize(s);
+    }
 #endif
 
 #ifdef CONFIG_PROFILER
@@ -4131,6 +4268,12 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
     }
 #endif
 
+    s->weighted_regalloc = tcg_weighted_regalloc ||
+                           (tb_tier_threshold && !(tb_cflags(tb) & CF_TIER0));
+    if (s->weighted_regalloc) {
+        tcg_count_uses(s);
+    }
+
     tcg_reg_alloc_start(s);
 
     s->code_buf = tb->tc.ptr;
@@ -4151,6 +4294,10 @@ int tcg_gen_code(TCGContext *s, TranslationBlock *tb)
         atomic_set(&prof->table_op_count[opc], prof->table_op_count[opc] + 1);
 #endif
 
+        if (s->weighted_regalloc) {
+            tcg_count_op_uses(s, op, -1);
+        }
+
         switch (opc) {
         case INDEX_op_mov_i32:
         case INDEX_op_mov_i64:
@@ -4269,8 +4416,14 @@ void tcg_dump_info(void)
                 (double)s->op_count / tb_div_count, s->op_count_max);
     qemu_printf("deleted ops/TB      %0.2f\n",
                 (double)s->del_op_count / tb_div_count);
+    qemu_printf("known-bits folds/TB %0.2f\n",
+                (double)s->kb_fold_count / tb_div_count);
     qemu_printf("avg temps/TB        %0.2f max=%d\n",
                 (double)s->temp_count / tb_div_count, s->temp_count_max);
+    qemu_printf("spills/TB           %0.2f\n",
+                (double)s->spill_count / tb_div_count);
+    qemu_printf("reloads/TB          %0.2f\n",
+                (double)s->reload_count / tb_div_count);
     qemu_printf("avg host code/TB    %0.1f\n",
                 (double)s->code_out_len / tb_div_count);
     qemu_printf("avg search data/TB  %0.1f\n",
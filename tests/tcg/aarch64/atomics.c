@@ -0,0 +1,134 @@
+/*
+ * Several threads bump shared counters with LDADD, SWP (as a spin
+ * lock), CAS and LDXR/STXR loops, in 32 and 64-bit forms; the final
+ * values must account for every increment.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define NR_THREADS 4
+#define ITERS 100000
+
+static uint32_t ldadd32;
+static uint64_t ldadd64;
+static uint32_t swp_lock;
+static uint64_t swp_locked;
+static uint32_t cas32;
+static uint64_t cas64;
+static uint32_t excl32;
+static uint64_t excl64;
+
+static void do_ldadd(void)
+{
+    uint32_t old32;
+    uint64_t old64;
+
+    asm volatile("ldadd %w2, %w0, [%1]"
+                 : "=&r"(old32) : "r"(&ldadd32), "r"(1) : "memory");
+    asm volatile("ldadd %2, %0, [%1]"
+                 : "=&r"(old64) : "r"(&ldadd64), "r"(1ul) : "memory");
+}
+
+static void do_swp(void)
+{
+    uint32_t old;
+
+    do {
+        asm volatile("swpa %w2, %w0, [%1]"
+                     : "=&r"(old) : "r"(&swp_lock), "r"(1) : "memory");
+    } while (old);
+    swp_locked++;
+    asm volatile("stlr wzr, [%0]" : : "r"(&swp_lock) : "memory");
+}
+
+static void do_cas(void)
+{
+    uint32_t old32, cmp32;
+    uint64_t old64, cmp64;
+
+    old32 = cas32;
+    do {
+        cmp32 = old32;
+        asm volatile("casal %w0, %w2, [%1]"
+                     : "+r"(old32) : "r"(&cas32), "r"(cmp32 + 1) : "memory");
+    } while (old32 != cmp32);
+
+    old64 = cas64;
+    do {
+        cmp64 = old64;
+        asm volatile("casal %0, %2, [%1]"
+                     : "+r"(old64) : "r"(&cas64), "r"(cmp64 + 1) : "memory");
+    } while (old64 != cmp64);
+}
+
+static void do_excl(void)
+{
+    uint32_t tmp32, fail;
+    uint64_t tmp64;
+
+    asm volatile("1: ldaxr %w0, [%2]\n\t"
+                 "add %w0, %w0, #1\n\t"
+                 "stlxr %w1, %w0, [%2]\n\t"
+                 "cbnz %w1, 1b"
+                 : "=&r"(tmp32), "=&r"(fail) : "r"(&excl32) : "memory");
+    asm volatile("1: ldaxr %0, [%2]\n\t"
+                 "add %0, %0, #1\n\t"
+                 "stlxr %w1, %0, [%2]\n\t"
+                 "cbnz %w1, 1b"
+                 : "=&r"(tmp64), "=&r"(fail) : "r"(&excl64) : "memory");
+}
+
+static void *worker(void *arg)
+{
+    int i;
+
+    for (i = 0; i < ITERS; i++) {
+        do_ldadd();
+        do_swp();
+        do_cas();
+        do_excl();
+    }
+    return NULL;
+}
+
+static int check(const char *name, uint64_t got)
+{
+    uint64_t want = (uint64_t)NR_THREADS * ITERS;
+
+    if (got != want) {
+        fprintf(stderr, "%s: got %llu, expected %llu\n", name,
+                (unsigned long long)got, (unsigned long long)want);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    pthread_t threads[NR_THREADS];
+    int i, err = 0;
+
+    for (i = 0; i < NR_THREADS; i++) {
+        if (pthread_create(&threads[i], NULL, worker, NULL)) {
+            perror("pthread_create");
+            return EXIT_FAILURE;
+        }
+    }
+    for (i = 0; i < NR_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    err |= check("ldadd 32", ldadd32);
+    err |= check("ldadd 64", ldadd64);
+    err |= check("swp lock", swp_locked);
+    err |= check("cas 32", cas32);
+    err |= check("cas 64", cas64);
+    err |= check("ldxr/stxr 32", excl32);
+    err |= check("ldxr/stxr 64", excl64);
+    return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/*
+ * Check that a condition consumed straight after CMP/TST agrees with the
+ * same condition evaluated from NZCV.  The "nop" in the reference
+ * sequences keeps the translator from fusing the compare with its user.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint64_t values[] = {
+    0, 1, 2, 0x7f, 0x80, 0x7fffffff, 0x80000000, 0xffffffff,
+    0x100000000ull, 0x7fffffffffffffffull, 0x8000000000000000ull,
+    0xfffffffffffffffeull, 0xffffffffffffffffull, 0xdeadbeefcafef00dull,
+};
+
+#define N_VALUES (sizeof(values) / sizeof(values[0]))
+
+#define CSET_TEST(name, cmp, cond)                                      \
+static int name(uint64_t a, uint64_t b, int fused)                      \
+{                                                                       \
+    uint64_t r;                                                         \
+    if (fused) {                                                        \
+        asm(cmp "\n\tcset %w0, " cond : "=r"(r) : "r"(a), "r"(b) : "cc"); \
+    } else {                                                            \
+        asm(cmp "\n\tnop\n\tcset %w0, " cond                            \
+            : "=r"(r) : "r"(a), "r"(b) : "cc");                         \
+    }                                                                   \
+    return r;                                                           \
+}
+
+#define BCOND_TEST(name, cmp, cond)                                     \
+static int name(uint64_t a, uint64_t b, int fused)                      \
+{                                                                       \
+    uint64_t r;                                                         \
+    if (fused) {                                                        \
+        asm("mov %w0, #1\n\t" cmp "\n\tb." cond " 1f\n\t"               \
+            "mov %w0, #0\n1:" : "=&r"(r) : "r"(a), "r"(b) : "cc");      \
+    } else {                                                            \
+        asm("mov %w0, #1\n\t" cmp "\n\tnop\n\tb." cond " 1f\n\t"        \
+            "mov %w0, #0\n1:" : "=&r"(r) : "r"(a), "r"(b) : "cc");      \
+    }                                                                   \
+    return r;                                                           \
+}
+
+#define CONDS(X, kind, cmp)                                             \
+    X(kind##_eq, cmp, "eq") X(kind##_ne, cmp, "ne")                     \
+    X(kind##_hs, cmp, "hs") X(kind##_lo, cmp, "lo")                     \
+    X(kind##_mi, cmp, "mi") X(kind##_pl, cmp, "pl")                     \
+    X(kind##_hi, cmp, "hi") X(kind##_ls, cmp, "ls")                     \
+    X(kind##_ge, cmp, "ge") X(kind##_lt, cmp, "lt")                     \
+    X(kind##_gt, cmp, "gt") X(kind##_le, cmp, "le")
+
+CONDS(CSET_TEST, cset_cmp_x, "cmp %x1, %x2")
+CONDS(CSET_TEST, cset_cmp_w, "cmp %w1, %w2")
+CONDS(CSET_TEST, cset_tst_x, "tst %x1, %x2")
+CONDS(CSET_TEST, cset_tst_w, "tst %w1, %w2")
+CONDS(BCOND_TEST, b_cmp_x, "cmp %x1, %x2")
+CONDS(BCOND_TEST, b_cmp_w, "cmp %w1, %w2")
+CONDS(BCOND_TEST, b_tst_x, "tst %x1, %x2")
+CONDS(BCOND_TEST, b_tst_w, "tst %w1, %w2")
+
+typedef int (*test_fn)(uint64_t, uint64_t, int);
+
+#define ENTRY(name, cmp, cond) { #name, name },
+static const struct {
+    const char *name;
+    test_fn fn;
+} tests[] = {
+    CONDS(ENTRY, cset_cmp_x, 0) CONDS(ENTRY, cset_cmp_w, 0)
+    CONDS(ENTRY, cset_tst_x, 0) CONDS(ENTRY, cset_tst_w, 0)
+    CONDS(ENTRY, b_cmp_x, 0) CONDS(ENTRY, b_cmp_w, 0)
+    CONDS(ENTRY, b_tst_x, 0) CONDS(ENTRY, b_tst_w, 0)
+};
+
+int main(void)
+{
+    int errors = 0;
+    size_t t, i, j;
+
+    for (t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+        for (i = 0; i < N_VALUES; i++) {
+            for (j = 0; j < N_VALUES; j++) {
+                int want = tests[t].fn(values[i], values[j], 0);
+                int got = tests[t].fn(values[i], values[j], 1);
+                if (want != got) {
+                    printf("%s(0x%016llx, 0x%016llx): got %d, expected %d\n",
+                           tests[t].name, (unsigned long long)values[i],
+                           (unsigned long long)values[j], got, want);
+                    errors++;
+                }
+            }
+        }
+    }
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/*
+ * Check TBL/TBX against a C reference for every table length, both
+ * vector widths, out-of-range indices and a table wrapping from V31
+ * to V0.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TBL_TEST(name, op, arr, list)                                   \
+static void name(const uint8_t *table, const uint8_t *idx, uint8_t *res) \
+{                                                                       \
+    asm("ld1 {v16.16b-v19.16b}, [%0]\n\t"                               \
+        "mov v31.16b, v16.16b\n\t"                                      \
+        "mov v0.16b, v17.16b\n\t"                                       \
+        "ldr q20, [%1]\n\t"                                             \
+        "ldr q21, [%2]\n\t"                                             \
+        op " v21." arr ", " list ", v20." arr "\n\t"                    \
+        "str q21, [%2]"                                                 \
+        : : "r"(table), "r"(idx), "r"(res)                              \
+        : "memory", "v0", "v16", "v17", "v18", "v19", "v20", "v21", "v31"); \
+}
+
+#define TBL_LENS(X, op, arr)                                            \
+    X(op##_##arr##_1, #op, #arr, "{v16.16b}")                           \
+    X(op##_##arr##_2, #op, #arr, "{v16.16b, v17.16b}")                  \
+    X(op##_##arr##_3, #op, #arr, "{v16.16b, v17.16b, v18.16b}")         \
+    X(op##_##arr##_4, #op, #arr, "{v16.16b, v17.16b, v18.16b, v19.16b}") \
+    X(op##_##arr##_w, #op, #arr, "{v31.16b, v0.16b}")
+
+TBL_LENS(TBL_TEST, tbl, 16b)
+TBL_LENS(TBL_TEST, tbl, 8b)
+TBL_LENS(TBL_TEST, tbx, 16b)
+TBL_LENS(TBL_TEST, tbx, 8b)
+
+typedef void tbl_fn(const uint8_t *, const uint8_t *, uint8_t *);
+
+static const struct {
+    const char *name;
+    tbl_fn *fn;
+    int nregs;
+    int is_q;
+    int is_tbx;
+} tests[] = {
+#define T(op, arr, q, x)                                                \
+    { #op "." #arr " x1", op##_##arr##_1, 1, q, x },                    \
+    { #op "." #arr " x2", op##_##arr##_2, 2, q, x },                    \
+    { #op "." #arr " x3", op##_##arr##_3, 3, q, x },                    \
+    { #op "." #arr " x4", op##_##arr##_4, 4, q, x },                    \
+    { #op "." #arr " wrap", op##_##arr##_w, 2, q, x },
+    T(tbl, 16b, 1, 0) T(tbl, 8b, 0, 0) T(tbx, 16b, 1, 1) T(tbx, 8b, 0, 1)
+#undef T
+};
+
+int main(void)
+{
+    uint8_t table[64], idx[16], res[16], ref[16];
+    int i, j, k, err = 0;
+
+    srand(1);
+    for (k = 0; k < 1000; k++) {
+        for (i = 0; i < 64; i++) {
+            table[i] = rand();
+        }
+        for (i = 0; i < 16; i++) {
+            idx[i] = (k & 1) ? rand() : rand() % 80;
+        }
+        for (j = 0; j < sizeof(tests) / sizeof(tests[0]); j++) {
+            int n = tests[j].is_q ? 16 : 8;
+
+            for (i = 0; i < 16; i++) {
+                res[i] = rand();
+            }
+            memset(ref, 0, sizeof(ref));
+            for (i = 0; i < n; i++) {
+                if (idx[i] < 16 * tests[j].nregs) {
+                    ref[i] = table[idx[i]];
+                } else if (tests[j].is_tbx) {
+                    ref[i] = res[i];
+                }
+            }
+            tests[j].fn(table, idx, res);
+            if (memcmp(res, ref, sizeof(ref))) {
+                printf("FAIL: %s, iteration %d\n", tests[j].name, k);
+                err = 1;
+            }
+        }
+    }
+    return err;
+}
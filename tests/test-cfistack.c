@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2020 上海芯竹科技有限公司
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "exec/cfistack.h"
+
+/* enough crossings to grow the stack from nothing a few times */
+#define N (3 * CFI_STACK_INIT_SIZE + 5)
+
+static CFIEntry entries[N];
+
+static void push_all(CFIStack *s)
+{
+    int i;
+
+    for (i = 0; i < N; i++) {
+        entries[i].x64_pc = i;
+        cfi_stack_push(s, &entries[i]);
+        g_assert_cmpint(s->depth, ==, i + 1);
+        g_assert_true(cfi_stack_top(s) == &entries[i]);
+    }
+    g_assert_cmpint(s->capacity, >=, N);
+}
+
+static void check_depth(CFIStack *s, int depth)
+{
+    int i;
+
+    g_assert_cmpint(s->depth, ==, depth);
+    g_assert_true(cfi_stack_top(s) == (depth ? &entries[depth - 1] : NULL));
+    for (i = 0; i < depth; i++) {
+        g_assert_true(cfi_stack_get(s, i) == &entries[depth - 1 - i]);
+        g_assert_cmpint(entries[depth - 1 - i].depth, ==, depth - 1 - i);
+    }
+    g_assert_null(cfi_stack_get(s, depth));
+    g_assert_null(cfi_stack_get(s, -1));
+}
+
+/* a zeroed stack, as in a freshly created CPU, takes pushes */
+static void test_push(void)
+{
+    CFIStack s = {};
+
+    g_assert_null(cfi_stack_top(&s));
+    g_assert_null(cfi_stack_get(&s, 0));
+    push_all(&s);
+    check_depth(&s, N);
+    g_free(s.entries);
+}
+
+static void test_drop(void)
+{
+    CFIStack s = {};
+
+    push_all(&s);
+    cfi_stack_drop(&s, 0);
+    check_depth(&s, N);
+    cfi_stack_drop(&s, -1);
+    check_depth(&s, N);
+    cfi_stack_drop(&s, CFI_STACK_INIT_SIZE + 1);
+    check_depth(&s, N - CFI_STACK_INIT_SIZE - 1);
+
+    /* an oversized count empties the stack */
+    cfi_stack_drop(&s, N);
+    check_depth(&s, 0);
+    cfi_stack_drop(&s, 1);
+    check_depth(&s, 0);
+
+    /* and it can be pushed again */
+    push_all(&s);
+    check_depth(&s, N);
+    g_free(s.entries);
+}
+
+static void test_truncate(void)
+{
+    CFIStack s = {};
+    int capacity;
+
+    push_all(&s);
+    capacity = s.capacity;
+
+    cfi_stack_truncate_to(&s, &entries[N - 1]);
+    check_depth(&s, N);
+    cfi_stack_truncate_to(&s, &entries[CFI_STACK_INIT_SIZE * 2]);
+    check_depth(&s, CFI_STACK_INIT_SIZE * 2 + 1);
+    cfi_stack_pop_to(&s, &entries[CFI_STACK_INIT_SIZE]);
+    check_depth(&s, CFI_STACK_INIT_SIZE);
+    cfi_stack_truncate_to(&s, &entries[0]);
+    check_depth(&s, 1);
+    cfi_stack_pop_to(&s, &entries[0]);
+    check_depth(&s, 0);
+
+    /* pushing back to the old depth does not grow the array again */
+    push_all(&s);
+    check_depth(&s, N);
+    g_assert_cmpint(s.capacity, ==, capacity);
+    g_free(s.entries);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/cfistack/push", test_push);
+    g_test_add_func("/cfistack/drop", test_drop);
+    g_test_add_func("/cfistack/truncate", test_truncate);
+    return g_test_run();
+}
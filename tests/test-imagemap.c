@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2020 上海芯竹科技有限公司
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/atomic.h"
+#include "qemu/thread.h"
+#include "bsd-user/imagemap.h"
+
+/*
+ * A synthetic dyld shared cache: the __TEXT of every image is laid out
+ * back to back in one region, the way the cache does it, with a one page
+ * hole after every 8th image. Images are added in a shuffled order.
+ */
+#define N 2000
+#define BASE 0x180000000ULL
+#define PAGE 0x1000
+
+static ImageRange images[N];
+
+static void setup(void)
+{
+    uintptr_t addr = BASE;
+    int i;
+
+    for (i = 0; i < N; i++) {
+        uintptr_t size = PAGE * (1 + i % 7);
+
+        images[i] = (ImageRange) {
+            .start = addr,
+            .end = addr + size,
+            .header = (const void *)addr,
+            .text_size = size,
+            .foreign = i & 1,
+        };
+        addr += size;
+        if (i % 8 == 7) {
+            addr += PAGE;
+        }
+    }
+}
+
+static int perm(int i)
+{
+    /* 1021 is prime to N, so this visits every index once; it keeps parity */
+    return (i * 1021) % N;
+}
+
+static void add_all(void)
+{
+    int i;
+
+    for (i = 0; i < N; i++) {
+        g_assert_true(image_map_add(&images[perm(i)]));
+    }
+}
+
+static void remove_all(void)
+{
+    int i;
+
+    for (i = 0; i < N; i++) {
+        image_map_remove(images[i].header, NULL);
+    }
+}
+
+static void check_present(int i)
+{
+    ImageRange r;
+
+    g_assert_true(image_map_lookup(images[i].start, &r));
+    g_assert_true(r.header == images[i].header);
+    g_assert_true(image_map_lookup(images[i].end - 1, &r));
+    g_assert_true(r.header == images[i].header);
+    g_assert_cmpuint(r.text_size, ==, images[i].text_size);
+    g_assert_cmpint(r.foreign, ==, images[i].foreign);
+}
+
+static void check_absent(int i)
+{
+    ImageRange r;
+
+    g_assert_false(image_map_lookup(images[i].start, &r));
+}
+
+static void test_lookup(void)
+{
+    ImageRange r;
+    int i;
+
+    add_all();
+    for (i = 0; i < N; i++) {
+        check_present(i);
+        if (i % 8 == 7) {
+            /* the hole after this image */
+            g_assert_false(image_map_lookup(images[i].end, &r));
+        }
+    }
+    g_assert_false(image_map_lookup(BASE - 1, &r));
+    g_assert_false(image_map_lookup(images[N - 1].end, &r));
+    g_assert_false(image_map_lookup(0, &r));
+    g_assert_false(image_map_lookup(UINTPTR_MAX, &r));
+    remove_all();
+}
+
+static void test_overlap(void)
+{
+    ImageRange r;
+    int i = N / 2;
+
+    add_all();
+
+    /* the same image twice */
+    g_assert_false(image_map_add(&images[i]));
+
+    /* straddling two neighbours */
+    r = images[i];
+    r.header = (const void *)0x1;
+    r.start = images[i].end - PAGE / 2;
+    r.end = images[i + 1].start + PAGE / 2;
+    g_assert_false(image_map_add(&r));
+
+    /* covering a whole run of images, the shape of a whole-image span */
+    r.start = images[i].start - 1;
+    r.end = images[i + 16].end + 1;
+    g_assert_false(image_map_add(&r));
+
+    /* inside one image */
+    r.start = images[i].start + 1;
+    r.end = images[i].end - 1;
+    g_assert_false(image_map_add(&r));
+
+    /* empty */
+    r.start = r.end = images[7].end;
+    g_assert_false(image_map_add(&r));
+
+    /* rejected inserts left the map alone */
+    for (i = 0; i < N; i++) {
+        check_present(i);
+    }
+
+    /* the hole after images[7] fits exactly */
+    r = images[7];
+    r.header = (const void *)images[7].end;
+    r.start = images[7].end;
+    r.end = images[8].start;
+    g_assert_true(image_map_add(&r));
+    g_assert_true(image_map_lookup(r.start, &r));
+    g_assert_true(r.header == (const void *)images[7].end);
+    check_present(7);
+    check_present(8);
+    g_assert_true(image_map_remove(r.header, &r));
+    g_assert_true(r.start == images[7].end);
+    g_assert_false(image_map_remove(r.header, NULL));
+
+    remove_all();
+}
+
+static void test_remove(void)
+{
+    int i;
+
+    add_all();
+    for (i = 0; i < N; i += 2) {
+        image_map_remove(images[i].header, NULL);
+    }
+    for (i = 0; i < N; i++) {
+        if (i & 1) {
+            check_present(i);
+        } else {
+            check_absent(i);
+        }
+    }
+
+    /* removed ranges can be taken again */
+    for (i = 0; i < N; i += 2) {
+        g_assert_true(image_map_add(&images[i]));
+    }
+    for (i = 0; i < N; i++) {
+        check_present(i);
+    }
+    remove_all();
+    for (i = 0; i < N; i++) {
+        check_absent(i);
+    }
+}
+
+/*
+ * Readers look up the odd images, which stay in the map, while the even
+ * ones are added and removed around them.
+ */
+static bool stop;
+
+static void *reader(void *arg)
+{
+    unsigned long n = 0;
+
+    while (!atomic_read(&stop)) {
+        check_present(2 * (n % (N / 2)) + 1);
+        n++;
+    }
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    QemuThread threads[4];
+    int i, round;
+
+    for (i = 1; i < N; i += 2) {
+        g_assert_true(image_map_add(&images[i]));
+    }
+
+    atomic_set(&stop, false);
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        qemu_thread_create(&threads[i], "reader", reader, NULL,
+                           QEMU_THREAD_JOINABLE);
+    }
+    for (round = 0; round < 20; round++) {
+        for (i = 0; i < N; i += 2) {
+            g_assert_true(image_map_add(&images[perm(i)]));
+        }
+        for (i = 0; i < N; i += 2) {
+            image_map_remove(images[i].header, NULL);
+        }
+    }
+    atomic_set(&stop, true);
+    for (i = 0; i < ARRAY_SIZE(threads); i++) {
+        qemu_thread_join(&threads[i]);
+    }
+    remove_all();
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    setup();
+    g_test_add_func("/imagemap/lookup", test_lookup);
+    g_test_add_func("/imagemap/overlap", test_overlap);
+    g_test_add_func("/imagemap/remove", test_remove);
+    g_test_add_func("/imagemap/concurrent", test_concurrent);
+    return g_test_run();
+}
@@ -337,6 +337,9 @@ const QEMULogItem qemu_log_items[] = {
       "log every user-mode syscall, its input, and its result" },
     { LOG_ABI_BRIDGE, "bridge",
       "log abi bridge assembly code" },
+    { LOG_STATS, "stats",
+      "user mode only: log cache and pool statistics, and print the\n"
+      "translation statistics at exit" },
     { 0, NULL, NULL },
 };
 